@@ -10,6 +10,11 @@
 
 static const CLR_INT64 c_MaximumTimeToActive = (TIME_CONVERSION__ONEMINUTE * TIME_CONVERSION__TO_SECONDS);
 
+// see CLR_RT_GarbageCollector::m_compactionThreshold
+#if !defined(TINYCLR_COMPACTION_THRESHOLD)
+#define TINYCLR_COMPACTION_THRESHOLD 0
+#endif
+
 
 //--//
 
@@ -60,6 +65,20 @@ HRESULT CLR_RT_ExecutionEngine::ExecutionEngine_Initialize()
     m_threadsWaiting.DblLinkedList_Initialize();    // CLR_RT_DblLinkedList                m_threadsWaiting;
     m_threadsZombie .DblLinkedList_Initialize();    // CLR_RT_DblLinkedList                m_threadsZombie;
                                                     // int                                 m_lastPid;
+                                                    // CLR_RT_Thread*                      m_currentThread;
+                                                    //
+    memset( m_lockTable, 0, sizeof(m_lockTable) );  // LockTableEntry                      m_lockTable[ c_LockTableSize ];
+    m_lockTableOverflow = false;                    // bool                                m_lockTableOverflow;
+    m_lockContentions   = 0;                        // CLR_UINT32                          m_lockContentions;
+                                                    //
+    AllocationProfile_Start( 0 );                   // bool                                m_allocProfileEnabled;
+                                                    // CLR_UINT32                          m_allocProfileSampleInterval;
+                                                    // CLR_UINT32                          m_allocProfileCountdown;
+                                                    // AllocProfileEntry                   m_allocProfile[ c_AllocProfileTypes ];
+                                                    // AllocProfileEntry                   m_allocProfileOther;
+                                                    // AllocProfileSample                  m_allocProfileSamples[ c_AllocProfileSamples ];
+                                                    // CLR_UINT32                          m_allocProfileNextSample;
+    AllocationProfile_Stop();                       //
                                                     //
     m_finalizersAlive  .DblLinkedList_Initialize(); // CLR_RT_DblLinkedList                m_finalizersAlive;
     m_finalizersPending.DblLinkedList_Initialize(); // CLR_RT_DblLinkedList                m_finalizersPending;
@@ -233,6 +252,8 @@ HRESULT CLR_RT_ExecutionEngine::AllocateHeaps()
         heapFree      -= size;
     }
 
+    g_CLR_RT_GarbageCollector.m_compactionThreshold = TINYCLR_COMPACTION_THRESHOLD;
+
     TINYCLR_NOCLEANUP();
 }
 
@@ -282,6 +303,9 @@ void CLR_RT_ExecutionEngine::ExecutionEngine_Cleanup()
     ReleaseAllThreads( m_threadsWaiting );
     ReleaseAllThreads( m_threadsZombie  );
 
+    memset( m_lockTable, 0, sizeof(m_lockTable) );
+    m_lockTableOverflow = false;
+
     g_CLR_RT_TypeSystem.TypeSystem_Cleanup();
     g_CLR_RT_EventCache.EventCache_Cleanup();
 
@@ -415,17 +439,46 @@ void CLR_RT_ExecutionEngine::ExecutionConstraint_Resume()
 
 //--//
 
+static void RecordPause( CLR_UINT32* histogram, CLR_INT64& pauseMax, CLR_INT64 pause )
+{
+    CLR_INT64 msec   = pause / TIME_CONVERSION__TO_MILLISECONDS;
+    int       bucket = 0;
+
+    while(msec > 0 && bucket < CLR_RT_GarbageCollector::c_pauseHistogramBuckets - 1)
+    {
+        msec >>= 1;
+        bucket++;
+    }
+
+    histogram[ bucket ]++;
+
+    if(pause > pauseMax) pauseMax = pause;
+}
+
 CLR_UINT32 CLR_RT_ExecutionEngine::PerformGarbageCollection()
 {
     NATIVE_PROFILE_CLR_CORE();
     m_heapState = c_HeapState_UnderGC;
 
+    CLR_INT64  start   = Time_GetMachineTime();
     CLR_UINT32 freeMem = g_CLR_RT_GarbageCollector.ExecuteGarbageCollection();
 
+    RecordPause( g_CLR_RT_GarbageCollector.m_gcPauseHistogram, g_CLR_RT_GarbageCollector.m_gcPauseMax, Time_GetMachineTime() - start );
+
     m_heapState = c_HeapState_Normal;
 
     m_lastHcUsed = NULL;
 
+    LockTable_Rebuild();
+
+    UpdateHeapFragmentation();
+
+    // compact at the next safe point, rather than after an allocation has already failed
+    if(g_CLR_RT_GarbageCollector.m_compactionThreshold != 0 && g_CLR_RT_GarbageCollector.m_fragmentation >= g_CLR_RT_GarbageCollector.m_compactionThreshold)
+    {
+        CLR_EE_SET( Compaction_Pending );
+    }
+
 #if !defined(BUILD_RTM) || defined(PLATFORM_WINDOWS)
     if(m_fPerformHeapCompaction) CLR_EE_SET( Compaction_Pending );
 #endif
@@ -440,13 +493,191 @@ void CLR_RT_ExecutionEngine::PerformHeapCompaction()
     NATIVE_PROFILE_CLR_CORE();
     if(CLR_EE_DBG_IS( NoCompaction )) return;
 
+    CLR_INT64 start = Time_GetMachineTime();
+
     g_CLR_RT_GarbageCollector.ExecuteCompaction();
 
+    RecordPause( g_CLR_RT_GarbageCollector.m_compactionPauseHistogram, g_CLR_RT_GarbageCollector.m_compactionPauseMax, Time_GetMachineTime() - start );
+
     CLR_EE_CLR( Compaction_Pending );
 
     m_lastHcUsed = NULL;
+
+    // the resources have moved
+    LockTable_Rebuild();
+
+    UpdateHeapFragmentation();
+}
+
+void CLR_RT_ExecutionEngine::UpdateHeapFragmentation()
+{
+    NATIVE_PROFILE_CLR_CORE();
+    CLR_UINT32 largest = 0;
+    CLR_UINT32 total   = 0;
+
+    TINYCLR_FOREACH_NODE(CLR_RT_HeapCluster,hc,m_heap)
+    {
+        TINYCLR_FOREACH_NODE(CLR_RT_HeapBlock_Node,ptr,hc->m_freeList)
+        {
+            CLR_UINT32 size = ptr->DataSize();
+
+            total += size;
+
+            if(size > largest) largest = size;
+        }
+        TINYCLR_FOREACH_NODE_END();
+    }
+    TINYCLR_FOREACH_NODE_END();
+
+    g_CLR_RT_GarbageCollector.m_largestFreeBytes = largest * sizeof(CLR_RT_HeapBlock);
+    g_CLR_RT_GarbageCollector.m_fragmentation    = (total != 0) ? 100 - (CLR_UINT32)(((CLR_UINT64)largest * 100) / total) : 0;
+}
+
+//--//
+
+void CLR_RT_ExecutionEngine::AllocationProfile_Start( CLR_UINT32 sampleInterval )
+{
+    NATIVE_PROFILE_CLR_CORE();
+    memset( m_allocProfile       , 0, sizeof(m_allocProfile       ) );
+    memset( &m_allocProfileOther , 0, sizeof(m_allocProfileOther  ) );
+    memset( m_allocProfileSamples, 0, sizeof(m_allocProfileSamples) );
+
+    m_allocProfileSampleInterval = sampleInterval;
+    m_allocProfileCountdown      = sampleInterval;
+    m_allocProfileNextSample     = 0;
+    m_allocProfileEnabled        = true;
+}
+
+void CLR_RT_ExecutionEngine::AllocationProfile_Stop()
+{
+    NATIVE_PROFILE_CLR_CORE();
+    m_allocProfileEnabled = false;
 }
 
+void CLR_RT_ExecutionEngine::AllocationProfile_Record( CLR_UINT32 key, CLR_UINT32 blocks )
+{
+    NATIVE_PROFILE_CLR_CORE();
+    AllocProfileEntry* entry = &m_allocProfileOther;
+    CLR_UINT32         slot  = (key ^ (key >> 16)) % c_AllocProfileTypes;
+
+    for(int i=0; i<c_AllocProfileTypes; i++)
+    {
+        AllocProfileEntry& candidate = m_allocProfile[ slot ];
+
+        if(candidate.m_key == 0) candidate.m_key = key;
+
+        if(candidate.m_key == key)
+        {
+            entry = &candidate;
+            break;
+        }
+
+        if(++slot == c_AllocProfileTypes) slot = 0;
+    }
+
+    entry->m_count += 1;
+    entry->m_bytes += blocks * sizeof(CLR_RT_HeapBlock);
+
+    if(m_allocProfileSampleInterval != 0 && --m_allocProfileCountdown == 0)
+    {
+        AllocProfileSample& sample = m_allocProfileSamples[ m_allocProfileNextSample++ % c_AllocProfileSamples ];
+
+        m_allocProfileCountdown = m_allocProfileSampleInterval;
+
+        sample.m_key    = key;
+        sample.m_method = 0;
+        sample.m_offset = 0;
+
+        if(m_currentThread != NULL)
+        {
+            CLR_RT_StackFrame* stack = m_currentThread->CurrentFrame();
+
+            if(stack->Prev() != NULL)
+            {
+                sample.m_method = stack->m_call.m_data;
+
+                if(stack->m_IPstart != NULL) sample.m_offset = (CLR_UINT32)(stack->m_IP - stack->m_IPstart);
+            }
+        }
+    }
+}
+
+static void AllocationProfile_PrintKey( CLR_UINT32 key )
+{
+    NATIVE_PROFILE_CLR_CORE();
+    char   rgBuffer[ 128 ];
+    LPSTR  szBuffer = rgBuffer;
+    size_t iBuffer  = MAXSTRLEN(rgBuffer);
+
+    if(key & CLR_RT_ExecutionEngine::c_AllocProfile_DataType)
+    {
+        CLR_Debug::Printf( "<datatype %d>", key & ~CLR_RT_ExecutionEngine::c_AllocProfile_DataType );
+    }
+    else
+    {
+        CLR_RT_TypeDef_Index cls; cls.m_data = key & ~CLR_RT_ExecutionEngine::c_AllocProfile_Array;
+
+        rgBuffer[ 0 ] = 0;
+
+        g_CLR_RT_TypeSystem.BuildTypeName( cls, szBuffer, iBuffer );
+
+        CLR_Debug::Printf( "%s%s", rgBuffer, (key & CLR_RT_ExecutionEngine::c_AllocProfile_Array) ? "[]" : "" );
+    }
+}
+
+void CLR_RT_ExecutionEngine::AllocationProfile_Dump()
+{
+    NATIVE_PROFILE_CLR_CORE();
+    CLR_Debug::Printf( "Allocations:\r\n" );
+
+    for(int i=0; i<c_AllocProfileTypes; i++)
+    {
+        AllocProfileEntry& entry = m_allocProfile[ i ];
+
+        if(entry.m_key == 0) continue;
+
+        CLR_Debug::Printf( "%8d objects %8d bytes ", entry.m_count, entry.m_bytes );
+
+        AllocationProfile_PrintKey( entry.m_key );
+
+        CLR_Debug::Printf( "\r\n" );
+    }
+
+    if(m_allocProfileOther.m_count)
+    {
+        CLR_Debug::Printf( "%8d objects %8d bytes <other types>\r\n", m_allocProfileOther.m_count, m_allocProfileOther.m_bytes );
+    }
+
+    for(int i=0; i<c_AllocProfileSamples; i++)
+    {
+        AllocProfileSample& sample = m_allocProfileSamples[ i ];
+
+        if(sample.m_key == 0) continue;
+
+        CLR_Debug::Printf( "Sample: " );
+
+        AllocationProfile_PrintKey( sample.m_key );
+
+        if(sample.m_method != 0)
+        {
+            char                   rgBuffer[ 128 ];
+            LPSTR                  szBuffer = rgBuffer;
+            size_t                 iBuffer  = MAXSTRLEN(rgBuffer);
+            CLR_RT_MethodDef_Index md; md.m_data = sample.m_method;
+
+            rgBuffer[ 0 ] = 0;
+
+            g_CLR_RT_TypeSystem.BuildMethodName( md, szBuffer, iBuffer );
+
+            CLR_Debug::Printf( " at %s +%04x", rgBuffer, sample.m_offset );
+        }
+
+        CLR_Debug::Printf( "\r\n" );
+    }
+}
+
+//--//
+
 void CLR_RT_ExecutionEngine::Relocate()
 {
     NATIVE_PROFILE_CLR_CORE();
@@ -1413,11 +1644,26 @@ void CLR_RT_ExecutionEngine::InsertThreadRoundRobin( CLR_RT_DblLinkedList& threa
     {
         int priTarget = thTarget->GetExecutionCounter();
 
-        TINYCLR_FOREACH_NODE__NODECL(CLR_RT_Thread,th,threads)
+        // The list is sorted by execution counter, highest first, and the thread goes before the
+        // first one with a lower counter. A thread that has just used up its quantum has the lowest
+        // counter, so look from the tail: that case needs no walk at all.
+        th = (CLR_RT_Thread*)threads.LastNode();
+
+        if(th->GetExecutionCounter() >= priTarget)
         {
-            if(th->GetExecutionCounter() < priTarget) break;
+            th = (CLR_RT_Thread*)threads.Tail();
+        }
+        else
+        {
+            while(true)
+            {
+                CLR_RT_Thread* thPrev = (CLR_RT_Thread*)th->Prev();
+
+                if(thPrev->Prev() == NULL || thPrev->GetExecutionCounter() >= priTarget) break;
+
+                th = thPrev;
+            }
         }
-        TINYCLR_FOREACH_NODE_END();
     }
 
     thTarget->m_waitForEvents         = 0;
@@ -1488,6 +1734,8 @@ CLR_RT_HeapBlock* CLR_RT_ExecutionEngine::ExtractHeapBlocksForArray( CLR_RT_Type
         pArray->m_sizeOfElement  =  dtl.m_sizeInBytes;
         pArray->m_fReference     = (dtl.m_flags & CLR_RT_DataTypeLookup::c_Numeric) == 0;
 
+        if(m_allocProfileEnabled) AllocationProfile_Record( c_AllocProfile_Array | inst.m_data, lengthHB );
+
 #if defined(TINYCLR_PROFILE_NEW_ALLOCATIONS)
         g_CLR_PRF_Profiler.TrackObjectCreation( pArray );
 #endif
@@ -1510,6 +1758,8 @@ CLR_RT_HeapBlock* CLR_RT_ExecutionEngine::ExtractHeapBlocksForClassOrValueTypes(
     {
         hb->SetObjectCls(cls);
 
+        if(m_allocProfileEnabled) AllocationProfile_Record( cls.m_data, length );
+
 #if defined(TINYCLR_PROFILE_NEW_ALLOCATIONS)
         g_CLR_PRF_Profiler.TrackObjectCreation( hb );
 #endif
@@ -1535,6 +1785,8 @@ CLR_RT_HeapBlock* CLR_RT_ExecutionEngine::ExtractHeapBlocksForObjects( CLR_UINT3
 
     CLR_RT_HeapBlock* hb = ExtractHeapBlocks( m_heap, dataType, flags, length );
 
+    if(hb && m_allocProfileEnabled) AllocationProfile_Record( c_AllocProfile_DataType | dataType, length );
+
 #if defined(TINYCLR_PROFILE_NEW_ALLOCATIONS)
     if(hb)
     {
@@ -1560,6 +1812,8 @@ CLR_RT_HeapBlock_Node* CLR_RT_ExecutionEngine::ExtractHeapBlocksForEvents( CLR_U
     {
         hb->GenericNode_Initialize();
 
+        if(m_allocProfileEnabled) AllocationProfile_Record( c_AllocProfile_DataType | dataType, length );
+
 #if defined(TINYCLR_PROFILE_NEW_ALLOCATIONS)
         g_CLR_PRF_Profiler.TrackObjectCreation( hb );
 #endif
@@ -1610,9 +1864,11 @@ CLR_RT_HeapBlock* CLR_RT_ExecutionEngine::ExtractHeapBlocks( CLR_RT_DblLinkedLis
             }
             else
             {
-                if(m_lastHcUsed != NULL)
+                CLR_RT_HeapCluster* lastHcUsed = m_lastHcUsed;
+
+                if(lastHcUsed != NULL)
                 {
-                    hb = m_lastHcUsed->ExtractBlocks( dataType, flags, length );
+                    hb = lastHcUsed->ExtractBlocks( dataType, flags, length );
                     if(hb)
                     {
                         return hb;
@@ -1621,6 +1877,9 @@ CLR_RT_HeapBlock* CLR_RT_ExecutionEngine::ExtractHeapBlocks( CLR_RT_DblLinkedLis
 
                 TINYCLR_FOREACH_NODE(CLR_RT_HeapCluster,hc,heap)
                 {
+                    // its free list was just walked and came up short
+                    if(hc == lastHcUsed) continue;
+
                     hb = hc->ExtractBlocks( dataType, flags, length );
                     if(hb)
                     {
@@ -2310,10 +2569,126 @@ CLR_RT_HeapBlock_Lock* CLR_RT_ExecutionEngine::FindLockObject( CLR_RT_DblLinkedL
     return NULL;
 }
 
+//
+// Only reflection objects are indexed: they are compared by value and have no storage for a lock.
+//
+static bool LockTable_Hash( CLR_RT_HeapBlock& object, CLR_UINT32& hash )
+{
+    CLR_RT_HeapBlock* ptr = &object;
+
+    if(ptr->DataType() == DATATYPE_OBJECT)
+    {
+        ptr = ptr->Dereference(); if(ptr == NULL) return false;
+    }
+
+    if(ptr->DataType() != DATATYPE_REFLECTION) return false;
+
+    CLR_UINT64 raw = ptr->ReflectionData().GetRawData();
+
+    hash = ((CLR_UINT32)raw ^ (CLR_UINT32)(raw >> 32)) * 0x9E3779B1;
+
+    return true;
+}
+
+CLR_RT_ExecutionEngine::LockTableEntry* CLR_RT_ExecutionEngine::LockTable_Find( CLR_RT_HeapBlock& object, CLR_UINT32 hash )
+{
+    NATIVE_PROFILE_CLR_CORE();
+    CLR_UINT32 idx = hash >> (32 - c_LockTableBits);
+
+    for(int i=0; i<c_LockTableSize; i++)
+    {
+        LockTableEntry&        entry = m_lockTable[ (idx + i) % c_LockTableSize ];
+        CLR_RT_HeapBlock_Lock* lock  = entry.m_lock;
+
+        if(lock == NULL) break;
+
+        //
+        // A released lock goes back to the event cache with another data type, or was reused
+        // as a new lock; either way the node header is still there until the next collection.
+        //
+        if(lock->DataType() != DATATYPE_LOCK_HEAD) continue;
+
+#if defined(TINYCLR_APPDOMAINS)
+        if(lock->m_appDomain != GetCurrentAppDomain()) continue;
+#endif
+
+        if(CLR_RT_HeapBlock::ObjectsEqual( lock->m_resource, object, true ))
+        {
+            return &entry;
+        }
+    }
+
+    return NULL;
+}
+
+void CLR_RT_ExecutionEngine::LockTable_Insert( CLR_RT_HeapBlock_Lock* lock, CLR_UINT32 hash, CLR_UINT32 contentions )
+{
+    NATIVE_PROFILE_CLR_CORE();
+    CLR_UINT32 idx = hash >> (32 - c_LockTableBits);
+
+    for(int i=0; i<c_LockTableSize; i++)
+    {
+        LockTableEntry& entry = m_lockTable[ (idx + i) % c_LockTableSize ];
+
+        if(entry.m_lock == NULL || entry.m_lock->DataType() != DATATYPE_LOCK_HEAD)
+        {
+            entry.m_lock        = lock;
+            entry.m_contentions = contentions;
+            return;
+        }
+    }
+
+    m_lockTableOverflow = true;
+}
+
+void CLR_RT_ExecutionEngine::LockTable_Insert( CLR_RT_DblLinkedList& threads, LockTableEntry* old )
+{
+    NATIVE_PROFILE_CLR_CORE();
+    TINYCLR_FOREACH_NODE(CLR_RT_Thread,th,threads)
+    {
+        TINYCLR_FOREACH_NODE(CLR_RT_HeapBlock_Lock,lock,th->m_locks)
+        {
+            CLR_UINT32 hash;
+
+            if(LockTable_Hash( lock->m_resource, hash ))
+            {
+                CLR_UINT32 contentions = 0;
+
+                for(int i=0; i<c_LockTableSize; i++)
+                {
+                    if(old[ i ].m_lock == lock)
+                    {
+                        contentions = old[ i ].m_contentions; break;
+                    }
+                }
+
+                LockTable_Insert( lock, hash, contentions );
+            }
+        }
+        TINYCLR_FOREACH_NODE_END();
+    }
+    TINYCLR_FOREACH_NODE_END();
+}
+
+void CLR_RT_ExecutionEngine::LockTable_Rebuild()
+{
+    NATIVE_PROFILE_CLR_CORE();
+    LockTableEntry old[ c_LockTableSize ];
+
+    memcpy( old, m_lockTable, sizeof(old) );
+
+    memset( m_lockTable, 0, sizeof(m_lockTable) );
+    m_lockTableOverflow = false;
+
+    LockTable_Insert( m_threadsReady  , old );
+    LockTable_Insert( m_threadsWaiting, old );
+}
+
 CLR_RT_HeapBlock_Lock* CLR_RT_ExecutionEngine::FindLockObject( CLR_RT_HeapBlock& object )
 {
     NATIVE_PROFILE_CLR_CORE();
     CLR_RT_HeapBlock_Lock* lock;
+    CLR_UINT32             hash;
 
     if(object.DataType() == DATATYPE_OBJECT)
     {
@@ -2330,6 +2705,16 @@ CLR_RT_HeapBlock_Lock* CLR_RT_ExecutionEngine::FindLockObject( CLR_RT_HeapBlock&
         }
     }
 
+    if(LockTable_Hash( object, hash ))
+    {
+        LockTableEntry* entry = LockTable_Find( object, hash );
+
+        if(entry) return entry->m_lock;
+
+        // every such lock is in the table, unless it filled up
+        if(!m_lockTableOverflow) return NULL;
+    }
+
     lock = FindLockObject( m_threadsReady  , object ); if(lock) return lock;
     lock = FindLockObject( m_threadsWaiting, object );          return lock;    
 }
@@ -2465,6 +2850,8 @@ void CLR_RT_ExecutionEngine::ProcessTimeEvent( CLR_UINT32 event )
     }
     TINYCLR_FOREACH_NODE_END();
 
+    InvalidateTimerCache();
+
     SpawnTimer();
 }
 
@@ -2650,11 +3037,29 @@ HRESULT CLR_RT_ExecutionEngine::LockObject( CLR_RT_HeapBlock& reference, CLR_RT_
 
     CLR_RT_HeapBlock_Lock* lock;
 
+    CLR_UINT32             hash;
+
     lock = FindLockObject( reference );
     
     if(lock == NULL)
     {
         TINYCLR_CHECK_HRESULT(CLR_RT_HeapBlock_Lock::CreateInstance( lock, sth->m_owningThread, reference ));
+
+        if(LockTable_Hash( reference, hash ))
+        {
+            LockTable_Insert( lock, hash, 0 );
+        }
+    }
+    else if(lock->m_owningThread != sth->m_owningThread)
+    {
+        m_lockContentions++;
+
+        if(LockTable_Hash( reference, hash ))
+        {
+            LockTableEntry* entry = LockTable_Find( reference, hash );
+
+            if(entry) entry->m_contentions++;
+        }
     }
 
     TINYCLR_SET_AND_LEAVE(CLR_RT_HeapBlock_Lock::IncrementOwnership( lock, sth, timeExpire, fForce ));
@@ -3608,6 +4013,8 @@ void CLR_RT_ExecutionEngine::UpdateTime()
             }
         }
         TINYCLR_FOREACH_NODE_END();
+
+        InvalidateTimerCache();
     }
     
 }
@@ -1482,6 +1482,58 @@ bool CLR_RT_Assembly::IsSameAssembly( const CLR_RT_Assembly& assm ) const
     return false;
 }
 
+//
+// The TypeDef index keys top-level types on namespace+name and nested types on enclosing type+name.
+// Both lookups always confirm a hit against the metadata strings, so hash collisions only cost a probe.
+//
+static CLR_UINT32 TypeIndex_Hash( LPCSTR name, CLR_UINT32 seed )
+{
+    NATIVE_PROFILE_CLR_CORE();
+    return SUPPORT_ComputeCRC( name, (CLR_UINT32)hal_strlen_s( name ), seed );
+}
+
+static CLR_UINT32 TypeIndex_HashTopLevel( LPCSTR name, LPCSTR nameSpace )
+{
+    NATIVE_PROFILE_CLR_CORE();
+    return TypeIndex_Hash( name, TypeIndex_Hash( nameSpace, 0 ) );
+}
+
+void CLR_RT_Assembly::TypeIndex_Initialize()
+{
+    NATIVE_PROFILE_CLR_CORE();
+    const CLR_RECORD_TYPEDEF* src     = GetTypeDef( 0 );
+    int                       tblSize = m_pTablesSize[ TBL_TypeDef ];
+    CLR_UINT32                mask    = m_iTypeIndexSize - 1;
+
+    if(m_iTypeIndexSize == 0) return;
+
+    for(int i=0; i<m_iTypeIndexSize; i++)
+    {
+        m_pTypeIndex[ i ] = CLR_EmptyIndex;
+    }
+
+    for(int i=0; i<tblSize; i++, src++)
+    {
+        CLR_UINT32 hash;
+
+        if(src->enclosingType == CLR_EmptyIndex)
+        {
+            hash = TypeIndex_HashTopLevel( GetString( src->name ), GetString( src->nameSpace ) );
+        }
+        else
+        {
+            hash = TypeIndex_Hash( GetString( src->name ), src->enclosingType );
+        }
+
+        //
+        // The table is at least twice the number of types, so there is always a free slot.
+        //
+        while(m_pTypeIndex[ hash & mask ] != CLR_EmptyIndex) hash++;
+
+        m_pTypeIndex[ hash & mask ] = (CLR_IDX)i;
+    }
+}
+
 void CLR_RT_Assembly::Assembly_Initialize( CLR_RT_Assembly::Offsets& offsets )
 {
     NATIVE_PROFILE_CLR_CORE();
@@ -1499,6 +1551,7 @@ void CLR_RT_Assembly::Assembly_Initialize( CLR_RT_Assembly::Offsets& offsets )
     m_pCrossReference_TypeDef     = (CLR_RT_TypeDef_CrossReference    *)buffer; buffer += offsets.iTypeDef       ;
     m_pCrossReference_FieldDef    = (CLR_RT_FieldDef_CrossReference   *)buffer; buffer += offsets.iFieldDef      ;
     m_pCrossReference_MethodDef   = (CLR_RT_MethodDef_CrossReference  *)buffer; buffer += offsets.iMethodDef     ;
+    m_pTypeIndex                  = (CLR_IDX                          *)buffer; buffer += offsets.iTypeIndex     ;
 
 #if !defined(TINYCLR_APPDOMAINS)
     m_pStaticFields               = (CLR_RT_HeapBlock                 *)buffer; buffer += offsets.iStaticFields  ;
@@ -1531,6 +1584,8 @@ void CLR_RT_Assembly::Assembly_Initialize( CLR_RT_Assembly::Offsets& offsets )
         }
     }
 
+    TypeIndex_Initialize();
+
 #if defined(TINYCLR_ENABLE_SOURCELEVELDEBUGGING)
     {
         m_pDebuggingInfo_MethodDef = (CLR_RT_MethodDef_DebuggingInfo*)buffer; buffer += offsets.iDebuggingInfoMethods;
@@ -1594,6 +1649,19 @@ HRESULT CLR_RT_Assembly::CreateInstance( const CLR_RECORD_ASSEMBLY* header, CLR_
         }
     }
 
+    //
+    // Size the TypeDef index to the next power of two holding twice the number of types, to keep probe chains short.
+    //
+    if(skeleton->m_pTablesSize[ TBL_TypeDef ] > 0)
+    {
+        skeleton->m_iTypeIndexSize = 1;
+
+        while(skeleton->m_iTypeIndexSize < skeleton->m_pTablesSize[ TBL_TypeDef ] * 2)
+        {
+            skeleton->m_iTypeIndexSize <<= 1;
+        }
+    }
+
     //--//
 
     {
@@ -1607,6 +1675,7 @@ HRESULT CLR_RT_Assembly::CreateInstance( const CLR_RECORD_ASSEMBLY* header, CLR_
         offsets.iTypeDef              = ROUNDTOMULTIPLE(skeleton->m_pTablesSize[ TBL_TypeDef     ] * sizeof(CLR_RT_TypeDef_CrossReference    ), CLR_UINT32);
         offsets.iFieldDef             = ROUNDTOMULTIPLE(skeleton->m_pTablesSize[ TBL_FieldDef    ] * sizeof(CLR_RT_FieldDef_CrossReference   ), CLR_UINT32);
         offsets.iMethodDef            = ROUNDTOMULTIPLE(skeleton->m_pTablesSize[ TBL_MethodDef   ] * sizeof(CLR_RT_MethodDef_CrossReference  ), CLR_UINT32);
+        offsets.iTypeIndex            = ROUNDTOMULTIPLE(skeleton->m_iTypeIndexSize               * sizeof(CLR_IDX                          ), CLR_UINT32);
 
         if(skeleton->m_header->numOfPatchedMethods > 0)
         {
@@ -1628,7 +1697,8 @@ HRESULT CLR_RT_Assembly::CreateInstance( const CLR_RECORD_ASSEMBLY* header, CLR_
                                offsets.iMethodRef      +
                                offsets.iTypeDef        +
                                offsets.iFieldDef       +
-                               offsets.iMethodDef;
+                               offsets.iMethodDef      +
+                               offsets.iTypeIndex;
 
 #if !defined(TINYCLR_APPDOMAINS)
         iTotalRamSize += offsets.iStaticFields;
@@ -1683,6 +1753,7 @@ HRESULT CLR_RT_Assembly::CreateInstance( const CLR_RECORD_ASSEMBLY* header, CLR_
             CLR_Debug::Printf( "   TypeDef        = %8d bytes (%8d elements)\r\n", offsets.iTypeDef       , skeleton->m_pTablesSize[ TBL_TypeDef     ] );
             CLR_Debug::Printf( "   FieldDef       = %8d bytes (%8d elements)\r\n", offsets.iFieldDef      , skeleton->m_pTablesSize[ TBL_FieldDef    ] );
             CLR_Debug::Printf( "   MethodDef      = %8d bytes (%8d elements)\r\n", offsets.iMethodDef     , skeleton->m_pTablesSize[ TBL_MethodDef   ] );
+            CLR_Debug::Printf( "   TypeIndex      = %8d bytes (%8d elements)\r\n", offsets.iTypeIndex     , skeleton->m_iTypeIndexSize                );
 #if !defined(TINYCLR_APPDOMAINS) 
             CLR_Debug::Printf( "   StaticFields   = %8d bytes (%8d elements)\r\n", offsets.iStaticFields  , skeleton->m_iStaticFields                );
 #endif
@@ -2857,6 +2928,51 @@ HRESULT CLR_RT_Assembly::Resolve_AllocateStaticFields( CLR_RT_HeapBlock* pStatic
     TINYCLR_NOCLEANUP();
 }
 
+#if defined(TINYCLR_RESOLUTION_SNAPSHOT)
+
+//
+// The snapshot covers everything Resolve_TypeRef, Resolve_FieldRef, Resolve_MethodRef, Resolve_Link and Resolve_ComputeHashes produce.
+// The AssemblyRef table holds heap pointers and is always resolved again, as are the well-known types and methods.
+//
+size_t CLR_RT_Assembly::Snapshot_Size()
+{
+    NATIVE_PROFILE_CLR_CORE();
+    return m_pTablesSize[ TBL_TypeRef   ] * sizeof(CLR_RT_TypeRef_CrossReference  ) +
+           m_pTablesSize[ TBL_FieldRef  ] * sizeof(CLR_RT_FieldRef_CrossReference ) +
+           m_pTablesSize[ TBL_MethodRef ] * sizeof(CLR_RT_MethodRef_CrossReference) +
+           m_pTablesSize[ TBL_TypeDef   ] * sizeof(CLR_RT_TypeDef_CrossReference  ) +
+           m_pTablesSize[ TBL_FieldDef  ] * sizeof(CLR_RT_FieldDef_CrossReference ) +
+           m_pTablesSize[ TBL_MethodDef ] * sizeof(CLR_RT_MethodDef_CrossReference);
+}
+
+void CLR_RT_Assembly::Snapshot_Save( CLR_UINT8*& buffer )
+{
+    NATIVE_PROFILE_CLR_CORE();
+    size_t len;
+
+    len = m_pTablesSize[ TBL_TypeRef   ] * sizeof(CLR_RT_TypeRef_CrossReference  ); memcpy( buffer, m_pCrossReference_TypeRef  , len ); buffer += len;
+    len = m_pTablesSize[ TBL_FieldRef  ] * sizeof(CLR_RT_FieldRef_CrossReference ); memcpy( buffer, m_pCrossReference_FieldRef , len ); buffer += len;
+    len = m_pTablesSize[ TBL_MethodRef ] * sizeof(CLR_RT_MethodRef_CrossReference); memcpy( buffer, m_pCrossReference_MethodRef, len ); buffer += len;
+    len = m_pTablesSize[ TBL_TypeDef   ] * sizeof(CLR_RT_TypeDef_CrossReference  ); memcpy( buffer, m_pCrossReference_TypeDef  , len ); buffer += len;
+    len = m_pTablesSize[ TBL_FieldDef  ] * sizeof(CLR_RT_FieldDef_CrossReference ); memcpy( buffer, m_pCrossReference_FieldDef , len ); buffer += len;
+    len = m_pTablesSize[ TBL_MethodDef ] * sizeof(CLR_RT_MethodDef_CrossReference); memcpy( buffer, m_pCrossReference_MethodDef, len ); buffer += len;
+}
+
+void CLR_RT_Assembly::Snapshot_Restore( const CLR_UINT8*& buffer )
+{
+    NATIVE_PROFILE_CLR_CORE();
+    size_t len;
+
+    len = m_pTablesSize[ TBL_TypeRef   ] * sizeof(CLR_RT_TypeRef_CrossReference  ); memcpy( m_pCrossReference_TypeRef  , buffer, len ); buffer += len;
+    len = m_pTablesSize[ TBL_FieldRef  ] * sizeof(CLR_RT_FieldRef_CrossReference ); memcpy( m_pCrossReference_FieldRef , buffer, len ); buffer += len;
+    len = m_pTablesSize[ TBL_MethodRef ] * sizeof(CLR_RT_MethodRef_CrossReference); memcpy( m_pCrossReference_MethodRef, buffer, len ); buffer += len;
+    len = m_pTablesSize[ TBL_TypeDef   ] * sizeof(CLR_RT_TypeDef_CrossReference  ); memcpy( m_pCrossReference_TypeDef  , buffer, len ); buffer += len;
+    len = m_pTablesSize[ TBL_FieldDef  ] * sizeof(CLR_RT_FieldDef_CrossReference ); memcpy( m_pCrossReference_FieldDef , buffer, len ); buffer += len;
+    len = m_pTablesSize[ TBL_MethodDef ] * sizeof(CLR_RT_MethodDef_CrossReference); memcpy( m_pCrossReference_MethodDef, buffer, len ); buffer += len;
+}
+
+#endif
+
 HRESULT CLR_RT_Assembly::PrepareForExecution()
 {
     NATIVE_PROFILE_CLR_CORE();
@@ -2934,22 +3050,30 @@ CLR_UINT32 CLR_RT_Assembly::ComputeAssemblyHash( const CLR_RECORD_ASSEMBLYREF* a
 bool CLR_RT_Assembly::FindTypeDef( LPCSTR name, LPCSTR nameSpace, CLR_RT_TypeDef_Index& idx )
 {
     NATIVE_PROFILE_CLR_CORE();
-    const CLR_RECORD_TYPEDEF* target  = GetTypeDef( 0 );
-    int                       tblSize = m_pTablesSize[ TBL_TypeDef ];
-
-    for(int i=0; i<tblSize; i++, target++)
+    if(m_iTypeIndexSize > 0)
     {
-        if(target->enclosingType == CLR_EmptyIndex)
+        CLR_UINT32 mask = m_iTypeIndexSize - 1;
+        CLR_UINT32 hash = TypeIndex_HashTopLevel( name, nameSpace );
+        CLR_IDX    i;
+
+        while((i = m_pTypeIndex[ hash & mask ]) != CLR_EmptyIndex)
         {
-            LPCSTR szNameSpace = GetString( target->nameSpace );
-            LPCSTR szName      = GetString( target->name      );
+            const CLR_RECORD_TYPEDEF* target = GetTypeDef( i );
 
-            if(!strcmp( szName, name ) && !strcmp( szNameSpace, nameSpace ))
+            if(target->enclosingType == CLR_EmptyIndex)
             {
-                idx.Set( m_idx, i );
+                LPCSTR szNameSpace = GetString( target->nameSpace );
+                LPCSTR szName      = GetString( target->name      );
 
-                return true;
+                if(!strcmp( szName, name ) && !strcmp( szNameSpace, nameSpace ))
+                {
+                    idx.Set( m_idx, i );
+
+                    return true;
+                }
             }
+
+            hash++;
         }
     }
 
@@ -2961,20 +3085,51 @@ bool CLR_RT_Assembly::FindTypeDef( LPCSTR name, LPCSTR nameSpace, CLR_RT_TypeDef
 bool CLR_RT_Assembly::FindTypeDef( LPCSTR name, CLR_IDX scope, CLR_RT_TypeDef_Index& idx )
 {
     NATIVE_PROFILE_CLR_CORE();
-    const CLR_RECORD_TYPEDEF* target  = GetTypeDef( 0 );
-    int                       tblSize = m_pTablesSize[ TBL_TypeDef ];
-
-    for(int i=0; i<tblSize; i++, target++)
+    if(m_iTypeIndexSize > 0 && scope != CLR_EmptyIndex)
     {
-        if(target->enclosingType == scope)
+        CLR_UINT32 mask = m_iTypeIndexSize - 1;
+        CLR_UINT32 hash = TypeIndex_Hash( name, scope );
+        CLR_IDX    i;
+
+        while((i = m_pTypeIndex[ hash & mask ]) != CLR_EmptyIndex)
         {
-            LPCSTR szName = GetString( target->name );
+            const CLR_RECORD_TYPEDEF* target = GetTypeDef( i );
 
-            if(!strcmp( szName, name ))
+            if(target->enclosingType == scope)
             {
-                idx.Set( m_idx, i );
+                LPCSTR szName = GetString( target->name );
 
-                return true;
+                if(!strcmp( szName, name ))
+                {
+                    idx.Set( m_idx, i );
+
+                    return true;
+                }
+            }
+
+            hash++;
+        }
+    }
+    else
+    {
+        //
+        // Top-level types are indexed by namespace, so a name-only match has to scan the table.
+        //
+        const CLR_RECORD_TYPEDEF* target  = GetTypeDef( 0 );
+        int                       tblSize = m_pTablesSize[ TBL_TypeDef ];
+
+        for(int i=0; i<tblSize; i++, target++)
+        {
+            if(target->enclosingType == scope)
+            {
+                LPCSTR szName = GetString( target->name );
+
+                if(!strcmp( szName, name ))
+                {
+                    idx.Set( m_idx, i );
+
+                    return true;
+                }
             }
         }
     }
@@ -3701,12 +3856,189 @@ HRESULT CLR_RT_TypeSystem::LocateResource( CLR_RT_Assembly_Instance assm, CLR_IN
     TINYCLR_NOCLEANUP();
 }
 
+#if defined(TINYCLR_RESOLUTION_SNAPSHOT)
+
+static const char       c_ResolutionSnapshot_Name[] = "CLR_RESOLVE";
+static const CLR_UINT32 c_ResolutionSnapshot_Seed   = 0x52534C56; // 'RSLV'
+
+//
+// Each assembly stores 4 bytes per TypeRef, FieldRef and MethodRef, 8 per TypeDef and 2 per FieldDef and MethodDef.
+// mscorlib alone is around 4KB, and mscorlib with the Microsoft.SPOT and System assemblies of a typical application
+// comes to 6KB to 10KB. The STM32F4 configuration sector is 16KB, of which the regular configuration blocks use
+// well under 1KB, so 10KB lets one snapshot in and still leaves room for configuration updates. A larger set of
+// assemblies simply runs without a snapshot.
+//
+#if !defined(TINYCLR_RESOLUTION_SNAPSHOT_MAXSIZE)
+#define TINYCLR_RESOLUTION_SNAPSHOT_MAXSIZE (10 * 1024)
+#endif
+
+//
+// The key changes if any assembly is added, removed, reordered or redeployed, or if the cross-reference layout changes.
+//
+CLR_UINT32 CLR_RT_TypeSystem::ResolutionSnapshot_Key()
+{
+    NATIVE_PROFILE_CLR_CORE();
+    CLR_UINT32 key    = c_ResolutionSnapshot_Seed;
+    CLR_UINT32 layout = sizeof(CLR_RT_TypeRef_CrossReference) | (sizeof(CLR_RT_TypeDef_CrossReference) << 8) | (sizeof(CLR_RT_MethodDef_CrossReference) << 16);
+
+    key = SUPPORT_ComputeCRC( &layout, sizeof(layout), key );
+
+    TINYCLR_FOREACH_ASSEMBLY(*this)
+    {
+        CLR_UINT32 idx = pASSM->m_idx;
+
+        key = SUPPORT_ComputeCRC( &idx                           , sizeof(idx)                           , key );
+        key = SUPPORT_ComputeCRC( &pASSM->m_header->assemblyCRC, sizeof(pASSM->m_header->assemblyCRC), key );
+    }
+    TINYCLR_FOREACH_ASSEMBLY_END();
+
+    return key;
+}
+
+//
+// Only an execute-in-place configuration sector is used, so the snapshot is copied straight from flash into the
+// cross-reference tables. Those tables stay in RAM because the runtime updates the TypeDef flags after resolution.
+//
+const CLR_UINT8* CLR_RT_TypeSystem::ResolutionSnapshot_Find( CLR_UINT32 key )
+{
+    NATIVE_PROFILE_CLR_CORE();
+    HAL_CONFIG_BLOCK_STORAGE_DATA blData;
+    const HAL_CONFIG_BLOCK*       header;
+    size_t                        size = sizeof(CLR_UINT32);
+
+    if(!HAL_CONFIG_BLOCK::GetConfigSectorAddress( blData ) || !blData.isXIP         ) return NULL;
+    if(g_ConfigurationSector.ConfigurationLength == 0xFFFFFFFF                       ) return NULL;
+
+    header = (const HAL_CONFIG_BLOCK*)(blData.ConfigAddress + g_ConfigurationSector.ConfigurationLength);
+    header = header->Find( c_ResolutionSnapshot_Name, FALSE, FALSE );
+
+    if(header == NULL) return NULL;
+
+    TINYCLR_FOREACH_ASSEMBLY(*this)
+    {
+        size += pASSM->Snapshot_Size();
+    }
+    TINYCLR_FOREACH_ASSEMBLY_END();
+
+    if(header->Size != size || *(const CLR_UINT32*)header->Data() != key) return NULL;
+
+    return (const CLR_UINT8*)header->Data() + sizeof(CLR_UINT32);
+}
+
+void CLR_RT_TypeSystem::ResolutionSnapshot_Save( CLR_UINT32 key )
+{
+    NATIVE_PROFILE_CLR_CORE();
+    HAL_CONFIG_BLOCK_STORAGE_DATA blData;
+    const HAL_CONFIG_BLOCK*       last;
+    CLR_UINT8*                    snapshot;
+    CLR_UINT8*                    ptr;
+    size_t                        size = sizeof(CLR_UINT32);
+
+    if(!HAL_CONFIG_BLOCK::GetConfigSectorAddress( blData ) || !blData.isXIP) return;
+    if(g_ConfigurationSector.ConfigurationLength == 0xFFFFFFFF                ) return;
+
+    TINYCLR_FOREACH_ASSEMBLY(*this)
+    {
+        size += pASSM->Snapshot_Size();
+    }
+    TINYCLR_FOREACH_ASSEMBLY_END();
+
+    //
+    // Flash blocks are never rewritten in place: each redeploy changes the key and appends a new block behind the
+    // old one, which is only marked disabled. Compacting the sector to make room would erase it together with the
+    // network and other configuration, so the snapshot is only written into free space and kept small enough to
+    // leave plenty of room for the regular blocks. Stale snapshots are dropped when something else compacts.
+    //
+    if(size > TINYCLR_RESOLUTION_SNAPSHOT_MAXSIZE) return;
+
+    last = (const HAL_CONFIG_BLOCK*)(blData.ConfigAddress + g_ConfigurationSector.ConfigurationLength);
+    last = last->Find( "", FALSE, TRUE );
+
+    if(last == NULL || (size_t)last + sizeof(HAL_CONFIG_BLOCK) + size > blData.ConfigAddress + blData.BlockLength) return;
+
+    snapshot = (CLR_UINT8*)CLR_RT_Memory::Allocate( size ); if(snapshot == NULL) return;
+    ptr      = snapshot;
+
+    *(CLR_UINT32*)ptr = key; ptr += sizeof(CLR_UINT32);
+
+    TINYCLR_FOREACH_ASSEMBLY(*this)
+    {
+        pASSM->Snapshot_Save( ptr );
+    }
+    TINYCLR_FOREACH_ASSEMBLY_END();
+
+    if(!HAL_CONFIG_BLOCK::UpdateBlockWithName( c_ResolutionSnapshot_Name, snapshot, size, TRUE ))
+    {
+#if !defined(BUILD_RTM)
+        CLR_Debug::Printf( "Could not persist resolution snapshot (%d bytes)\r\n", size );
+#endif
+    }
+
+    CLR_RT_Memory::Release( snapshot );
+}
+
+#endif
+
 HRESULT CLR_RT_TypeSystem::ResolveAll()
 {
     NATIVE_PROFILE_CLR_CORE();
     TINYCLR_HEADER();
 
-    bool fOutput = false;
+    bool fOutput   = false;
+    bool fSnapshot = false;
+
+#if defined(TINYCLR_RESOLUTION_SNAPSHOT)
+    bool       fFullResolution = true;
+    CLR_UINT32 snapshotKey     = 0;
+
+    TINYCLR_FOREACH_ASSEMBLY(*this)
+    {
+        if(pASSM->m_flags & CLR_RT_Assembly::c_Resolved) fFullResolution = false;
+    }
+    TINYCLR_FOREACH_ASSEMBLY_END();
+
+    if(fFullResolution)
+    {
+        const CLR_UINT8* snapshot;
+
+        snapshotKey = ResolutionSnapshot_Key();
+        snapshot    = ResolutionSnapshot_Find( snapshotKey );
+
+        if(snapshot)
+        {
+            TINYCLR_FOREACH_ASSEMBLY(*this)
+            {
+                pASSM->Snapshot_Restore( snapshot );
+            }
+            TINYCLR_FOREACH_ASSEMBLY_END();
+
+            fSnapshot = true;
+        }
+    }
+#endif
+
+#if !defined(BUILD_RTM)
+    static LPCSTR const c_ResolvePhaseNames[] =
+    {
+        "AssemblyRef  ",
+        "TypeRef      ",
+        "FieldRef     ",
+        "MethodRef    ",
+        "TypeDef      ",
+        "MethodDef    ",
+        "Link         ",
+        "ComputeHashes",
+        "StaticFields ",
+    };
+
+    CLR_INT64 phaseTime[ ARRAYSIZE(c_ResolvePhaseNames) ]; memset( phaseTime, 0, sizeof(phaseTime) );
+    CLR_INT64 phaseStart;
+    CLR_INT64 resolveStart = Time_GetMachineTime();
+
+#define TINYCLR_RESOLVE_PHASE(phase) { CLR_INT64 now = Time_GetMachineTime(); phaseTime[ phase ] += now - phaseStart; phaseStart = now; }
+#else
+#define TINYCLR_RESOLVE_PHASE(phase)
+#endif
 
     while(true)
     {
@@ -3719,23 +4051,38 @@ HRESULT CLR_RT_TypeSystem::ResolveAll()
             {
                 fNeedResolution = true;
 
-                if(pASSM->Resolve_AssemblyRef( fOutput ))
+#if !defined(BUILD_RTM)
+                phaseStart = Time_GetMachineTime();
+#endif
+
+                bool fResolved = pASSM->Resolve_AssemblyRef( fOutput ); TINYCLR_RESOLVE_PHASE(0);
+
+                if(fResolved)
                 {
                     fGot = true;
 
                     pASSM->m_flags |= CLR_RT_Assembly::c_Resolved;
 
-                    TINYCLR_CHECK_HRESULT(pASSM->Resolve_TypeRef       ());
-                    TINYCLR_CHECK_HRESULT(pASSM->Resolve_FieldRef      ());
-                    TINYCLR_CHECK_HRESULT(pASSM->Resolve_MethodRef     ());
-                    /********************/pASSM->Resolve_TypeDef       () ;
-                    /********************/pASSM->Resolve_MethodDef     () ;
-                    /********************/pASSM->Resolve_Link          () ;
-                    TINYCLR_CHECK_HRESULT(pASSM->Resolve_ComputeHashes ());
+                    if(fSnapshot)
+                    {
+                        /********************/pASSM->Resolve_TypeDef       () ; TINYCLR_RESOLVE_PHASE(4);
+                        /********************/pASSM->Resolve_MethodDef     () ; TINYCLR_RESOLVE_PHASE(5);
+                    }
+                    else
+                    {
+                        TINYCLR_CHECK_HRESULT(pASSM->Resolve_TypeRef       ()); TINYCLR_RESOLVE_PHASE(1);
+                        TINYCLR_CHECK_HRESULT(pASSM->Resolve_FieldRef      ()); TINYCLR_RESOLVE_PHASE(2);
+                        TINYCLR_CHECK_HRESULT(pASSM->Resolve_MethodRef     ()); TINYCLR_RESOLVE_PHASE(3);
+                        /********************/pASSM->Resolve_TypeDef       () ; TINYCLR_RESOLVE_PHASE(4);
+                        /********************/pASSM->Resolve_MethodDef     () ; TINYCLR_RESOLVE_PHASE(5);
+                        /********************/pASSM->Resolve_Link          () ; TINYCLR_RESOLVE_PHASE(6);
+                        TINYCLR_CHECK_HRESULT(pASSM->Resolve_ComputeHashes ()); TINYCLR_RESOLVE_PHASE(7);
+                    }
 
 #if !defined(TINYCLR_APPDOMAINS)
                     TINYCLR_CHECK_HRESULT(pASSM->Resolve_AllocateStaticFields( pASSM->m_pStaticFields ));
 #endif
+                    TINYCLR_RESOLVE_PHASE(8);
 
                     pASSM->m_flags |= CLR_RT_Assembly::c_ResolutionCompleted;
                 }
@@ -3765,10 +4112,30 @@ HRESULT CLR_RT_TypeSystem::ResolveAll()
         }
     }
 
+#undef TINYCLR_RESOLVE_PHASE
+
+#if defined(TINYCLR_RESOLUTION_SNAPSHOT)
+    if(fFullResolution && !fSnapshot)
+    {
+        ResolutionSnapshot_Save( snapshotKey );
+    }
+#endif
+
 #if !defined(BUILD_RTM)
 
     if(s_CLR_RT_fTrace_AssemblyOverhead >= c_CLR_RT_Trace_Info)
     {
+        {
+            CLR_INT64 resolveTime = Time_GetMachineTime() - resolveStart;
+
+            CLR_Debug::Printf( "\r\nResolution: %d msec%s\r\n", (int)(resolveTime / TIME_CONVERSION__TO_MILLISECONDS), fSnapshot ? " (snapshot)" : "" );
+
+            for(int phase=0; phase<ARRAYSIZE(c_ResolvePhaseNames); phase++)
+            {
+                CLR_Debug::Printf( "   %s  = %8d usec\r\n", c_ResolvePhaseNames[ phase ], (int)(phaseTime[ phase ] * 1000 / TIME_CONVERSION__TO_MILLISECONDS) );
+            }
+        }
+
         {
             int                      pTablesSize[ TBL_Max ]; memset(  pTablesSize, 0, sizeof(pTablesSize) );
             CLR_RT_Assembly::Offsets offsets               ; memset( &offsets    , 0, sizeof(offsets    ) );
@@ -3788,6 +4155,7 @@ HRESULT CLR_RT_TypeSystem::ResolveAll()
                 offsets.iTypeDef              += ROUNDTOMULTIPLE(pASSM->m_pTablesSize[ TBL_TypeDef     ] * sizeof(CLR_RT_TypeDef_CrossReference    ), CLR_UINT32);
                 offsets.iFieldDef             += ROUNDTOMULTIPLE(pASSM->m_pTablesSize[ TBL_FieldDef    ] * sizeof(CLR_RT_FieldDef_CrossReference   ), CLR_UINT32);
                 offsets.iMethodDef            += ROUNDTOMULTIPLE(pASSM->m_pTablesSize[ TBL_MethodDef   ] * sizeof(CLR_RT_MethodDef_CrossReference  ), CLR_UINT32);
+                offsets.iTypeIndex            += ROUNDTOMULTIPLE(pASSM->m_iTypeIndexSize               * sizeof(CLR_IDX                          ), CLR_UINT32);
 
 #if !defined(TINYCLR_APPDOMAINS)
                 offsets.iStaticFields         += ROUNDTOMULTIPLE(pASSM->m_iStaticFields                * sizeof(CLR_RT_HeapBlock                 ), CLR_UINT32);
@@ -3826,7 +4194,8 @@ HRESULT CLR_RT_TypeSystem::ResolveAll()
                             offsets.iMethodRef      +
                             offsets.iTypeDef        +
                             offsets.iFieldDef       +
-                            offsets.iMethodDef;
+                            offsets.iMethodDef      +
+                            offsets.iTypeIndex;
 
 #if !defined(TINYCLR_APPDOMAINS)
             iTotalRamSize += offsets.iStaticFields;
@@ -3844,6 +4213,7 @@ HRESULT CLR_RT_TypeSystem::ResolveAll()
             CLR_Debug::Printf( "   TypeDef        = %8d bytes (%8d elements)\r\n", offsets.iTypeDef       , pTablesSize[TBL_TypeDef    ] );
             CLR_Debug::Printf( "   FieldDef       = %8d bytes (%8d elements)\r\n", offsets.iFieldDef      , pTablesSize[TBL_FieldDef   ] );
             CLR_Debug::Printf( "   MethodDef      = %8d bytes (%8d elements)\r\n", offsets.iMethodDef     , pTablesSize[TBL_MethodDef  ] );
+            CLR_Debug::Printf( "   TypeIndex      = %8d bytes\r\n"                 , offsets.iTypeIndex                                 );
 
 #if !defined(TINYCLR_APPDOMAINS)
             CLR_Debug::Printf( "   StaticFields   = %8d bytes (%8d elements)\r\n", offsets.iStaticFields  , iStaticFields                );
@@ -876,6 +876,15 @@ struct CLR_RT_SignatureParser
 // This type is needed on PC only for Interop code generation. For device code forward declaration only
 class CLR_RT_VectorOfManagedElements;
 
+//
+// Resolved cross-reference tables can be persisted in the configuration sector and reused on the next boot
+// if the same set of assemblies is loaded in the same order. The snapshot takes several KB of a sector that
+// also holds the network and other configuration, so a platform opts in by defining TINYCLR_RESOLUTION_SNAPSHOT.
+//
+#if defined(PLATFORM_WINDOWS) || defined(PLATFORM_WINCE)
+#undef TINYCLR_RESOLUTION_SNAPSHOT
+#endif
+
 struct CLR_RT_Assembly : public CLR_RT_HeapBlock_Node // EVENT HEAP - NO RELOCATION -
 {
     struct Offsets
@@ -888,6 +897,7 @@ struct CLR_RT_Assembly : public CLR_RT_HeapBlock_Node // EVENT HEAP - NO RELOCAT
         size_t iTypeDef;
         size_t iFieldDef;
         size_t iMethodDef;
+        size_t iTypeIndex;
 
 #if !defined(TINYCLR_APPDOMAINS)
         size_t iStaticFields;
@@ -920,6 +930,7 @@ struct CLR_RT_Assembly : public CLR_RT_HeapBlock_Node // EVENT HEAP - NO RELOCAT
 #endif
 
     int                                m_pTablesSize[ TBL_Max ];
+    int                                m_iTypeIndexSize;              // Power of two, zero if the assembly defines no types.
 
 #if !defined(TINYCLR_APPDOMAINS)
     CLR_RT_HeapBlock*                  m_pStaticFields;               // EVENT HEAP - NO RELOCATION - (but the data they point to has to be relocated)
@@ -936,6 +947,7 @@ struct CLR_RT_Assembly : public CLR_RT_HeapBlock_Node // EVENT HEAP - NO RELOCAT
     CLR_RT_TypeDef_CrossReference    * m_pCrossReference_TypeDef    ; // EVENT HEAP - NO RELOCATION - (but the data they point to has to be relocated)
     CLR_RT_FieldDef_CrossReference   * m_pCrossReference_FieldDef   ; // EVENT HEAP - NO RELOCATION - (but the data they point to has to be relocated)
     CLR_RT_MethodDef_CrossReference  * m_pCrossReference_MethodDef  ; // EVENT HEAP - NO RELOCATION - (but the data they point to has to be relocated)
+    CLR_IDX                          * m_pTypeIndex                 ; // EVENT HEAP - NO RELOCATION - Open addressed TypeDef lookup, CLR_EmptyIndex marks a free slot.
 
 #if defined(TINYCLR_ENABLE_SOURCELEVELDEBUGGING)
     CLR_RT_MethodDef_DebuggingInfo  * m_pDebuggingInfo_MethodDef   ; //EVENT HEAP - NO RELOCATION - (but the data they point to has to be relocated)
@@ -970,6 +982,7 @@ struct CLR_RT_Assembly : public CLR_RT_HeapBlock_Node // EVENT HEAP - NO RELOCAT
     void           DestroyInstance(                                                         );
 
     void Assembly_Initialize( CLR_RT_Assembly::Offsets& offsets );
+    void TypeIndex_Initialize(                                   );
 
     bool    Resolve_AssemblyRef           ( bool fOutput );
     HRESULT Resolve_TypeRef               (              );
@@ -981,6 +994,12 @@ struct CLR_RT_Assembly : public CLR_RT_HeapBlock_Node // EVENT HEAP - NO RELOCAT
     HRESULT Resolve_ComputeHashes         (              );
     HRESULT Resolve_AllocateStaticFields  ( CLR_RT_HeapBlock* pStaticFields );
 
+#if defined(TINYCLR_RESOLUTION_SNAPSHOT)
+    size_t  Snapshot_Size                 (                                 );
+    void    Snapshot_Save                 ( CLR_UINT8*&       buffer        );
+    void    Snapshot_Restore              ( const CLR_UINT8*& buffer        );
+#endif
+
     static HRESULT VerifyEndian(CLR_RECORD_ASSEMBLY* header);
 
     HRESULT PrepareForExecution();
@@ -1492,6 +1511,13 @@ struct CLR_RT_TypeSystem // EVENT HEAP - NO RELOCATION -
     void    PostLinkageProcessing( CLR_RT_Assembly* assm );
 
     HRESULT ResolveAll               (                   );
+
+#if defined(TINYCLR_RESOLUTION_SNAPSHOT)
+    CLR_UINT32       ResolutionSnapshot_Key (                  );
+    const CLR_UINT8* ResolutionSnapshot_Find( CLR_UINT32 key   );
+    void             ResolutionSnapshot_Save( CLR_UINT32 key   );
+#endif
+
     HRESULT PrepareForExecution      (                   );
     HRESULT PrepareForExecutionHelper( LPCSTR szAssembly );
 
@@ -2117,9 +2143,20 @@ struct CLR_RT_GarbageCollector
     static const CLR_UINT32 c_DumpGraphHeapEvent    = 0x00000004;
     static const CLR_UINT32 c_DumpPerfCountersEvent = 0x00000008;
 
+    static const int        c_pauseHistogramBuckets = 8; // <1ms, <2ms, <4ms, ... <64ms, >=64ms
+
     CLR_UINT32            m_numberOfGarbageCollections;
     CLR_UINT32            m_numberOfCompactions;
 
+    CLR_UINT32            m_gcPauseHistogram        [ c_pauseHistogramBuckets ]; // collections by pause time
+    CLR_UINT32            m_compactionPauseHistogram[ c_pauseHistogramBuckets ]; // compactions by pause time
+    CLR_INT64             m_gcPauseMax;                                           // in machine time units
+    CLR_INT64             m_compactionPauseMax;
+
+    CLR_UINT32            m_largestFreeBytes;     // largest free block, updated after each collection or compaction
+    CLR_UINT32            m_fragmentation;        // percent of free memory outside the largest free block
+    CLR_UINT32            m_compactionThreshold;  // compact after a collection at this fragmentation percent, 0 disables
+
     CLR_RT_DblLinkedList  m_weakDelegates_Reachable;              // list of CLR_RT_HeapBlock_Delegate_List
 
 
@@ -3003,6 +3040,57 @@ struct CLR_RT_ExecutionEngine
     int                                 m_lastPid;
     CLR_RT_Thread*                      m_currentThread;
 
+    //
+    // Locks on objects without a lock of their own (typeof(X)), see FindLockObject.
+    // Open addressed, entries whose lock has been released are recognized and reused,
+    // the table is rebuilt after each garbage collection.
+    //
+    static const int                    c_LockTableBits         = 5;
+    static const int                    c_LockTableSize         = 1 << c_LockTableBits;
+
+    struct LockTableEntry
+    {
+        CLR_RT_HeapBlock_Lock* m_lock;
+        CLR_UINT32             m_contentions;           // times a thread had to wait for it
+    };
+
+    LockTableEntry                      m_lockTable[ c_LockTableSize ];
+    bool                                m_lockTableOverflow;    // some locks are missing, fall back to the thread scan
+    CLR_UINT32                          m_lockContentions;      // for all locks
+
+    //
+    // Allocation profiler, counts objects and bytes per type while enabled.
+    // Class and value type instances are keyed on their TypeDef, arrays on their element TypeDef
+    // tagged with c_AllocProfile_Array, everything else on its data type tagged with c_AllocProfile_DataType.
+    // Every m_allocProfileSampleInterval-th allocation also records the method and IL offset that caused it.
+    //
+    static const int                    c_AllocProfileTypes     = 32;
+    static const int                    c_AllocProfileSamples   = 16;
+    static const CLR_UINT32             c_AllocProfile_Array    = 0x80000000;
+    static const CLR_UINT32             c_AllocProfile_DataType = 0x40000000;
+
+    struct AllocProfileEntry
+    {
+        CLR_UINT32 m_key;                                       // 0 marks a free entry
+        CLR_UINT32 m_count;
+        CLR_UINT32 m_bytes;
+    };
+
+    struct AllocProfileSample
+    {
+        CLR_UINT32 m_key;
+        CLR_UINT32 m_method;                                    // CLR_RT_MethodDef_Index, 0 if allocated outside managed code
+        CLR_UINT32 m_offset;                                    // IL offset within m_method
+    };
+
+    bool                                m_allocProfileEnabled;
+    CLR_UINT32                          m_allocProfileSampleInterval; // 0 disables allocation site sampling
+    CLR_UINT32                          m_allocProfileCountdown;
+    AllocProfileEntry                   m_allocProfile[ c_AllocProfileTypes ];
+    AllocProfileEntry                   m_allocProfileOther;    // types that did not fit in the table, m_key unused
+    AllocProfileSample                  m_allocProfileSamples[ c_AllocProfileSamples ];
+    CLR_UINT32                          m_allocProfileNextSample;
+
     CLR_RT_DblLinkedList                m_finalizersAlive;      // EVENT HEAP - NO RELOCATION - list of CLR_RT_HeapBlock_Finalizer
     CLR_RT_DblLinkedList                m_finalizersPending;    // EVENT HEAP - NO RELOCATION - list of CLR_RT_HeapBlock_Finalizer
     CLR_RT_Thread*                      m_finalizerThread;      // EVENT HEAP - NO RELOCATION -
@@ -3061,6 +3149,11 @@ struct CLR_RT_ExecutionEngine
 
     CLR_UINT32 PerformGarbageCollection();
     void       PerformHeapCompaction   ();
+    void       UpdateHeapFragmentation ();
+
+    void       AllocationProfile_Start ( CLR_UINT32 sampleInterval );
+    void       AllocationProfile_Stop  (                           );
+    void       AllocationProfile_Dump  (                           );
 
     void Relocate();
 
@@ -3206,6 +3299,13 @@ private:
     CLR_RT_HeapBlock_Lock* FindLockObject( CLR_RT_DblLinkedList& threads, CLR_RT_HeapBlock& object );
     CLR_RT_HeapBlock_Lock* FindLockObject(                                CLR_RT_HeapBlock& object );
 
+    LockTableEntry* LockTable_Find   ( CLR_RT_HeapBlock& object, CLR_UINT32 hash                        );
+    void            LockTable_Insert ( CLR_RT_HeapBlock_Lock* lock, CLR_UINT32 hash, CLR_UINT32 contentions );
+    void            LockTable_Insert ( CLR_RT_DblLinkedList& threads, LockTableEntry* old                  );
+    void            LockTable_Rebuild(                                                                      );
+
+    void AllocationProfile_Record( CLR_UINT32 key, CLR_UINT32 blocks );
+
     void      CheckTimers    ( CLR_INT64& timeoutMin                                );
     void      CheckThreads   ( CLR_INT64& timeoutMin, CLR_RT_DblLinkedList& threads );
 
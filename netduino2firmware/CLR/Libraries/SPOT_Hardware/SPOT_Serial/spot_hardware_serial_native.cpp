@@ -64,6 +64,7 @@ static const CLR_RT_MethodHandler method_lookup[] =
     Library_spot_hardware_serial_native_System_IO_Ports_SerialPort::InternalSetDataEventRaised___VOID,
 #endif
     NULL,
+    Library_spot_hardware_serial_native_System_IO_Ports_SerialPort::ReadFrame___I4__SZARRAY_U1__I4__I4__I4__I4,
 };
 
 const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_Microsoft_SPOT_Hardware_SerialPort =
@@ -53,6 +53,7 @@ struct Library_spot_hardware_serial_native_System_IO_Ports_SerialPort
 #if defined(PLATFORM_ARM_Netduino2) || defined(PLATFORM_ARM_NetduinoPlus2) || defined(PLATFORM_ARM_NetduinoGo) || defined(PLATFORM_ARM_NetduinoShieldBase)
     TINYCLR_NATIVE_DECLARE(InternalSetDataEventRaised___VOID);
 #endif
+    TINYCLR_NATIVE_DECLARE(ReadFrame___I4__SZARRAY_U1__I4__I4__I4__I4);
     //--//
 
 };
@@ -205,6 +205,154 @@ HRESULT Library_spot_hardware_serial_native_System_IO_Ports_SerialPort::Read___I
     TINYCLR_NOCLEANUP();
 }
 
+// ReadFrame(buffer, offset, count, delimiter, interByteTimeout) fills the buffer until count bytes,
+// the delimiter byte (-1 for none, included in the result) or an interByteTimeout ms gap after the
+// first byte. The driver only wakes the thread once the frame is there; ReadTimeout bounds the call.
+HRESULT Library_spot_hardware_serial_native_System_IO_Ports_SerialPort::ReadFrame___I4__SZARRAY_U1__I4__I4__I4__I4( CLR_RT_StackFrame& stack )
+{
+    NATIVE_PROFILE_CLR_HARDWARE();
+    TINYCLR_HEADER();
+
+    CLR_RT_HeapBlock_Array* readBuffer;
+    CLR_RT_HeapBlock*       pThis;
+    CLR_RT_HeapBlock*       config;
+    CLR_UINT8*              ptr;
+    CLR_INT32               offset;
+    CLR_INT32               count;
+    CLR_INT32               delimiter;
+    CLR_INT32               interByteTimeout;
+    CLR_INT32               totLength;
+    CLR_INT32               totRead;
+    CLR_RT_HeapBlock*       timeout;
+    CLR_INT64*              timeoutTicks;
+    CLR_INT64               timeExpire;
+    CLR_INT32               port;
+    UINT64                  lastRxTicks;
+    BOOL                    fComplete;
+    bool                    fRes;
+
+    pThis = stack.This();  FAULT_ON_NULL(pThis);
+
+    // check if the object was disposed
+    if(pThis[ FIELD__m_fDisposed ].NumericByRef().s1 != 0) 
+    {
+        TINYCLR_SET_AND_LEAVE(CLR_E_OBJECT_DISPOSED);
+    }
+    
+    config = pThis[ FIELD__m_config ].Dereference(); FAULT_ON_NULL(config);
+
+    readBuffer       = stack.Arg1().DereferenceArray();  FAULT_ON_NULL(readBuffer);
+    offset           = stack.Arg2().NumericByRef().s4;
+    count            = stack.Arg3().NumericByRef().s4;
+    delimiter        = stack.Arg4().NumericByRef().s4;
+    interByteTimeout = stack.Arg5().NumericByRef().s4;
+    totLength        = readBuffer->m_numOfElements;
+    timeout          = &config[ Library_spot_hardware_serial_native_System_IO_Ports_SerialPort__Configuration::FIELD__ReadTimeout ];
+    port             = config[ Library_spot_hardware_serial_native_System_IO_Ports_SerialPort__Configuration::FIELD__PortIndex ].NumericByRef().s4;
+
+    if(stack.m_flags & CLR_RT_StackFrame::c_CalledOnPop)
+    {
+        //
+        // The frame is going away, whether the read finished, failed or the thread was aborted while waiting:
+        // disarm the driver, or it keeps holding back SYSTEM_EVENT_FLAG_COM_IN from the next reader.
+        //
+        ::USART_ReadFrame( port, NULL, 0, -1, 0, fComplete, lastRxTicks );
+
+        TINYCLR_SET_AND_LEAVE(S_OK);
+    }
+
+    //
+    // Bound checking.
+    //
+    if(offset < 0 || offset > totLength)
+    {
+        TINYCLR_SET_AND_LEAVE(CLR_E_OUT_OF_RANGE);
+    }
+
+    if(count == -1)
+    {
+        count = totLength - offset;
+    }
+    else
+    {
+        if(count < 0 || (offset+count) > totLength)
+        {
+            TINYCLR_SET_AND_LEAVE(CLR_E_OUT_OF_RANGE);
+        }
+    }
+
+    if(delimiter < -1 || delimiter > 0xFF || interByteTimeout < 0)
+    {
+        TINYCLR_SET_AND_LEAVE(CLR_E_OUT_OF_RANGE);
+    }
+
+    TINYCLR_CHECK_HRESULT(stack.SetupTimeout( *timeout, timeoutTicks ));
+
+    stack.m_flags |= CLR_RT_StackFrame::c_CallOnPop;
+
+    //
+    // Push "totRead" onto the eval stack.
+    //
+    if(stack.m_customState == 1)
+    {
+        stack.PushValueI4( 0 );
+        
+        stack.m_customState = 2;
+    }
+
+    //--//
+
+    totRead = stack.m_evalStack[ 1 ].NumericByRef().s4;
+
+    ptr = readBuffer->GetFirstElement() + offset;
+
+    while(true)
+    {
+        // until the first byte is in, the gap timeout has nothing to count from, so ask to be woken by it
+        size_t wakeCount = (totRead == 0 && interByteTimeout > 0) ? 1 : 0;
+
+        int read = ::USART_ReadFrame( port, (char*)ptr + totRead, count - totRead, delimiter, wakeCount, fComplete, lastRxTicks );
+
+        if(read < 0)
+        {
+            TINYCLR_SET_AND_LEAVE(CLR_E_INVALID_PARAMETER);
+        }
+
+        totRead += read;
+
+        stack.m_evalStack[ 1 ].NumericByRef().s4 = totRead;
+
+        if(fComplete) break;
+
+        timeExpire = *timeoutTicks;
+
+        if(totRead > 0 && interByteTimeout > 0)
+        {
+            CLR_INT64 gapExpire = HAL_Time_TicksToTime( lastRxTicks ) + (CLR_INT64)interByteTimeout * TIME_CONVERSION__TO_MILLISECONDS;
+
+            if(gapExpire < timeExpire) timeExpire = gapExpire;
+        }
+
+        if(Time_GetMachineTime() >= timeExpire)
+        {
+            if(totRead == 0)
+            {
+                TINYCLR_SET_AND_LEAVE(CLR_E_TIMEOUT);
+            }
+            break;
+        }
+
+        TINYCLR_CHECK_HRESULT(g_CLR_RT_ExecutionEngine.WaitEvents( stack.m_owningThread, timeExpire, CLR_RT_ExecutionEngine::c_Event_SerialPort, fRes ));
+    }
+
+    stack.PopValue();       // totRead
+    stack.PopValue();       // Timeout
+
+    stack.SetResult_I4( totRead );
+
+    TINYCLR_NOCLEANUP();
+}
+
 HRESULT Library_spot_hardware_serial_native_System_IO_Ports_SerialPort::Write___VOID__SZARRAY_U1__I4__I4( CLR_RT_StackFrame& stack )
 {
     NATIVE_PROFILE_CLR_HARDWARE();
@@ -56,7 +56,356 @@ static UINT8 CRC7Encode(UINT8 crc, UINT8 *input, int length)
     return crc;
 }
 
-#define SPI_DELAY 50
+// SPI mode timing limits from the SD physical layer specification.
+// The card paces itself through the data token and the busy signal on DO,
+// so the host only polls and gives up after these bounds.
+#define SD_CMD_RESPONSE_BYTES        8       // Ncr, maximum bytes before the R1 response
+#define SD_READ_TOKEN_TIMEOUT_USEC   100000  // Nac, 100 ms for SDSC and SDHC
+#define SD_WRITE_BUSY_TIMEOUT_USEC   500000  // 250 ms for SDSC, 500 ms for SDHC
+#define SD_ERASE_BUSY_TIMEOUT_USEC   2000000
+
+// multiple block transfers
+#ifndef SD_STOP_TRANSMISSION
+#define SD_STOP_TRANSMISSION         12
+#endif
+#ifndef SD_READ_MULTIPLE_BLOCK
+#define SD_READ_MULTIPLE_BLOCK       18
+#endif
+#ifndef SD_SET_WR_BLK_ERASE_COUNT
+#define SD_SET_WR_BLK_ERASE_COUNT    23      // ACMD23
+#endif
+#ifndef SD_WRITE_MULTIPLE_BLOCK
+#define SD_WRITE_MULTIPLE_BLOCK      25
+#endif
+#define SD_START_MULTI_WRITE_TOKEN   0xFC
+#define SD_STOP_TRAN_TOKEN           0xFD
+#define SD_MIN_SECTOR_RUN            2       // shorter runs use the single block commands
+
+// reads until the card sends something other than 0xFF; returns 0xFF on timeout
+static BYTE SD_WaitToken(UINT32 timeout_uSec)
+{
+    UINT64 start   = HAL_Time_CurrentTicks();
+    UINT64 timeout = CPU_MicrosecondsToTicks(timeout_uSec);
+    BYTE response;
+
+    while((response = SD_BS_Driver::SPISendByte(DUMMY)) == 0xFF)
+    {
+        if(HAL_Time_CurrentTicks() - start > timeout) break;
+    }
+
+    return response;
+}
+
+// reads until the card releases DO (0xFF), i.e. it is no longer busy
+static BOOL SD_WaitReady(UINT32 timeout_uSec)
+{
+    UINT64 start   = HAL_Time_CurrentTicks();
+    UINT64 timeout = CPU_MicrosecondsToTicks(timeout_uSec);
+
+    while(SD_BS_Driver::SPISendByte(DUMMY) != 0xFF)
+    {
+        if(HAL_Time_CurrentTicks() - start > timeout) return FALSE;
+    }
+
+    return TRUE;
+}
+
+//--//
+
+// The card's SPI bus is owned through s_busBusy instead of masking interrupts for the whole
+// transfer, which lasts as long as the card stays busy programming. Interrupts are only off
+// while ownership changes hands; mount and unmount run from a continuation, never from an ISR.
+static volatile BOOL s_busBusy;
+
+static BOOL SD_BusAcquire()
+{
+    {
+        GLOBAL_LOCK(irq);
+
+        if(s_busBusy)
+        {
+            return FALSE;
+        }
+
+        s_busBusy = TRUE;
+    }
+
+    CPU_SPI_Xaction_Start(g_SD_BL_Config.SPI);
+
+    return TRUE;
+}
+
+static void SD_BusRelease()
+{
+    CPU_SPI_Xaction_Stop(g_SD_BL_Config.SPI);
+
+    s_busBusy = FALSE;
+}
+
+//--//
+
+// Write-back sector cache. Partial sector updates (FAT and directory entries) are merged here
+// instead of a read/modify/write per update. IBlockStorageDevice has no flush, so neither
+// FileStream.Flush nor the FAT driver's own flush reaches this cache: a dirty sector goes to the
+// card when it is evicted, on StorageDevice.Flush or unmount, and at the latest
+// SD_CACHE_FLUSH_USEC after it was first dirtied. A sector the card refuses is dropped and
+// counted in s_cacheLost rather than retried.
+#ifndef SD_CACHE_SECTORS
+#define SD_CACHE_SECTORS 4
+#endif
+#ifndef SD_CACHE_FLUSH_USEC
+#define SD_CACHE_FLUSH_USEC 500000
+#endif
+
+struct SD_CACHE_ENTRY
+{
+    SectorAddress Sector;
+    UINT32        LastUse;
+    BOOL          Valid;
+    BOOL          Dirty;
+    BYTE          Data[SD_DATA_SIZE];
+};
+
+static SD_CACHE_ENTRY s_cache[SD_CACHE_SECTORS];
+static UINT32         s_cacheClock;
+static UINT32         s_cacheHits;
+static UINT32         s_cacheMisses;
+static UINT32         s_cacheLost;
+static HAL_COMPLETION s_cacheFlushCompletion;
+
+// Writes one sector with WRITE_SINGLE_BLOCK; the caller holds the SPI transaction.
+static BOOL SD_WriteSector(SectorAddress sectorAddress, BYTE* pBuff, UINT32 BytesPerSector)
+{
+    BYTE response;
+    BOOL fResult = FALSE;
+
+    SD_BS_Driver::SD_CsSetLow();
+
+    // send CMD24 --write single block data
+    response = SD_BS_Driver::SD_SendCmdWithR1Resp(SD_WRITE_SINGLE_BLOCK, sectorAddress << 9, 0xff, R1_IN_READY_STATUS);
+
+    if(response == R1_IN_READY_STATUS)
+    {
+        SD_BS_Driver::SPISendByte(SD_START_DATA_BLOCK_TOKEN); // send DATA_BLOCK_TOKEN
+
+        // send data
+        SD_BS_Driver::SPISendCount(pBuff, BytesPerSector);
+
+        // send CRC
+        SD_BS_Driver::SPISendByte(0xff);
+        SD_BS_Driver::SPISendByte(0xff);
+
+        // wait for end of write busy
+        fResult = (SD_BS_Driver::SD_CheckBusy() == SD_SUCCESS);
+    }
+
+    SD_BS_Driver::SD_CsSetHigh();
+
+    return fResult;
+}
+
+static SD_CACHE_ENTRY* SD_Cache_Find(SectorAddress sectorAddress)
+{
+    for(int i = 0; i < SD_CACHE_SECTORS; i++)
+    {
+        if(s_cache[i].Valid && s_cache[i].Sector == sectorAddress)
+        {
+            return &s_cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+// A failed write drops the entry; kept dirty it would stay the eviction victim for good.
+static BOOL SD_Cache_WriteBack(SD_CACHE_ENTRY* pEntry)
+{
+    BOOL fResult = SD_WriteSector(pEntry->Sector, pEntry->Data, SD_DATA_SIZE);
+
+    if(!fResult)
+    {
+        pEntry->Valid = FALSE;
+
+        s_cacheLost++;
+    }
+
+    pEntry->Dirty = FALSE;
+
+    return fResult;
+}
+
+static void SD_Cache_ArmFlush()
+{
+    if(!s_cacheFlushCompletion.IsLinked())
+    {
+        s_cacheFlushCompletion.EnqueueDelta64(SD_CACHE_FLUSH_USEC);
+    }
+}
+
+static void SD_Cache_MarkDirty(SD_CACHE_ENTRY* pEntry)
+{
+    pEntry->Dirty = TRUE;
+
+    SD_Cache_ArmFlush();
+}
+
+// Returns the cache entry for a sector. A miss takes a free entry, else the least recently
+// used clean one, and writes back the least recently used dirty one only when all are dirty.
+// fLoad reads the sector from the card; callers about to overwrite all of it pass FALSE.
+static SD_CACHE_ENTRY* SD_Cache_Get(SectorAddress sectorAddress, BOOL fLoad)
+{
+    SD_CACHE_ENTRY* pEntry = SD_Cache_Find(sectorAddress);
+
+    if(pEntry != NULL)
+    {
+        s_cacheHits++;
+    }
+    else
+    {
+        s_cacheMisses++;
+
+        pEntry = &s_cache[0];
+
+        for(int i = 1; i < SD_CACHE_SECTORS && pEntry->Valid; i++)
+        {
+            SD_CACHE_ENTRY* pCandidate = &s_cache[i];
+
+            if(!pCandidate->Valid || (pEntry->Dirty && !pCandidate->Dirty) ||
+               (pEntry->Dirty == pCandidate->Dirty && ((pCandidate->LastUse - pEntry->LastUse) & 0x80000000)))
+            {
+                pEntry = pCandidate;
+            }
+        }
+
+        // the failed entry is dropped, so the next miss gets a free one
+        if(pEntry->Valid && pEntry->Dirty && !SD_Cache_WriteBack(pEntry))
+        {
+            return NULL;
+        }
+
+        pEntry->Valid = FALSE;
+
+        if(fLoad && !SD_BS_Driver::ReadSector(sectorAddress, 0, SD_DATA_SIZE, pEntry->Data, SD_DATA_SIZE))
+        {
+            return NULL;
+        }
+
+        pEntry->Sector = sectorAddress;
+        pEntry->Valid  = TRUE;
+        pEntry->Dirty  = FALSE;
+    }
+
+    pEntry->LastUse = ++s_cacheClock;
+
+    return pEntry;
+}
+
+// Copies dirty cached sectors over a run just read from the card, they are newer.
+static void SD_Cache_Patch(SectorAddress sectorAddress, UINT32 SectorCount, BYTE* pBuff)
+{
+    for(int i = 0; i < SD_CACHE_SECTORS; i++)
+    {
+        if(s_cache[i].Dirty && s_cache[i].Sector >= sectorAddress && s_cache[i].Sector - sectorAddress < SectorCount)
+        {
+            memcpy(&pBuff[(s_cache[i].Sector - sectorAddress) * SD_DATA_SIZE], s_cache[i].Data, SD_DATA_SIZE);
+        }
+    }
+}
+
+// Drops cached copies of sectors that are about to be overwritten or erased on the card.
+static void SD_Cache_Discard(SectorAddress sectorAddress, UINT32 SectorCount)
+{
+    for(int i = 0; i < SD_CACHE_SECTORS; i++)
+    {
+        if(s_cache[i].Valid && s_cache[i].Sector >= sectorAddress && s_cache[i].Sector - sectorAddress < SectorCount)
+        {
+            s_cache[i].Valid = FALSE;
+            s_cache[i].Dirty = FALSE;
+        }
+    }
+}
+
+BOOL SD_BS_Cache_Flush()
+{
+    BOOL fResult = TRUE;
+    BOOL fDirty  = FALSE;
+
+    for(int i = 0; i < SD_CACHE_SECTORS; i++)
+    {
+        fDirty |= s_cache[i].Dirty;
+    }
+
+    if(fDirty)
+    {
+        if(!SD_BusAcquire())
+        {
+            return FALSE;
+        }
+
+        for(int i = 0; i < SD_CACHE_SECTORS; i++)
+        {
+            if(s_cache[i].Dirty && !SD_Cache_WriteBack(&s_cache[i]))
+            {
+                fResult = FALSE;
+            }
+        }
+
+        SD_BusRelease();
+    }
+
+    return fResult;
+}
+
+static void SD_Cache_AgeFlush(void* arg)
+{
+    SD_BS_Cache_Flush();
+
+    // anything still dirty found the bus busy, try again later
+    for(int i = 0; i < SD_CACHE_SECTORS; i++)
+    {
+        if(s_cache[i].Dirty)
+        {
+            SD_Cache_ArmFlush();
+            break;
+        }
+    }
+}
+
+// Drops every cached sector; returns how many were dirty, i.e. never reached the card.
+UINT32 SD_BS_Cache_Invalidate()
+{
+    GLOBAL_LOCK(irq);
+
+    UINT32 dropped = 0;
+
+    if(s_cacheFlushCompletion.IsLinked())
+    {
+        s_cacheFlushCompletion.Abort();
+    }
+
+    for(int i = 0; i < SD_CACHE_SECTORS; i++)
+    {
+        if(s_cache[i].Dirty)
+        {
+            dropped++;
+        }
+
+        s_cache[i].Valid = FALSE;
+        s_cache[i].Dirty = FALSE;
+    }
+
+    s_cacheLost += dropped;
+
+    return dropped;
+}
+
+void SD_BS_Cache_GetCounters(UINT32* pHits, UINT32* pMisses)
+{
+    *pHits   = s_cacheHits;
+    *pMisses = s_cacheMisses;
+}
+
+//--//
 
 BYTE SD_BS_Driver::SPISendByte(BYTE data)
 {
@@ -71,9 +420,7 @@ BYTE SD_BS_Driver::SPISendByte(BYTE data)
     config.WriteCount = 1;
     config.BusyPin.Pin = GPIO_PIN_NONE;
     
-    HAL_Time_Sleep_MicroSeconds(SPI_DELAY);
     CPU_SPI_Xaction_nWrite8_nRead8(config);
-    HAL_Time_Sleep_MicroSeconds(SPI_DELAY);
     
     return ReadByte;
 } 
@@ -92,9 +439,7 @@ void SD_BS_Driver::SPISendCount(BYTE *pWrite, UINT32 WriteCount)
     config.WriteCount = WriteCount;
     config.BusyPin.Pin = GPIO_PIN_NONE;
 
-    HAL_Time_Sleep_MicroSeconds(SPI_DELAY);
     CPU_SPI_Xaction_nWrite8_nRead8(config);
-	HAL_Time_Sleep_MicroSeconds(SPI_DELAY);
 }
 
 void SD_BS_Driver::SPIRecvCount(BYTE *pRead, UINT32 ReadCount, UINT32 Offset)
@@ -113,19 +458,15 @@ void SD_BS_Driver::SPIRecvCount(BYTE *pRead, UINT32 ReadCount, UINT32 Offset)
     config.WriteCount = 1;
     config.BusyPin.Pin = GPIO_PIN_NONE;
 
-	HAL_Time_Sleep_MicroSeconds(SPI_DELAY);
     CPU_SPI_Xaction_nWrite8_nRead8(config);
-	HAL_Time_Sleep_MicroSeconds(SPI_DELAY);
 }
 
 //Sets SD CS to INACTIVE state
 void SD_BS_Driver::SD_CsSetHigh()
 {
-    HAL_Time_Sleep_MicroSeconds(SPI_DELAY);
     CPU_GPIO_EnableOutputPin(g_SD_BL_Config.SPI.DeviceCS, !g_SD_BL_Config.SPI.CS_Active);
 
     // to force SDC/MMC to release the bus after CS goes inactive, do one dummy write.
-    HAL_Time_Sleep_MicroSeconds(SPI_DELAY);
     SPISendByte(DUMMY);
 }
 
@@ -133,45 +474,47 @@ void SD_BS_Driver::SD_CsSetHigh()
 void SD_BS_Driver::SD_CsSetLow()
 {
     CPU_GPIO_EnableOutputPin(g_SD_BL_Config.SPI.DeviceCS, g_SD_BL_Config.SPI.CS_Active);
-    HAL_Time_Sleep_MicroSeconds(SPI_DELAY);
 }
 
 BYTE SD_BS_Driver::SD_CheckBusy(void)
 {
     BYTE response;
-    BYTE rvalue = 0xFF;
+    BYTE rvalue;
+
+    // the data response token follows the CRC within a few bytes
+    for(int i = 0; i < SD_CMD_RESPONSE_BYTES; i++)
+    {
+        response = SPISendByte(DUMMY);
+        if(response != 0xFF) break;
+    }
 
-    for(int i=10000; i!=0; i--)
+    if(response == 0xFF)
     {
-        response = SPISendByte(0xff);
+        return response;
+    }
 
-        if(response != 0xFF && rvalue == 0xFF)
-        {
-            response &= 0x1f;
-            switch(response) /* 7 6 5 4 3    1 0  */
-            {
-                /* data response  x x x 0 status 1 */
-                case 0x05:
-                    rvalue = SD_SUCCESS;
-                    break;
+    switch(response & 0x1f) /* 7 6 5 4 3    1 0  */
+    {
+        /* data response  x x x 0 status 1 */
+        case 0x05:
+            rvalue = SD_SUCCESS;
+            break;
 
-                case 0x0b:
-                    return (SD_CRC_ERROR);
+        case 0x0b:
+            return (SD_CRC_ERROR);
 
-                case 0x0d:
-                    return (SD_WRITE_ERROR);
+        case 0x0d:
+            return (SD_WRITE_ERROR);
 
-                default:
-                    rvalue = SD_OTHER_ERROR;
-                    break;
-            }
-        }
-        else if(response != 0x00 && rvalue != 0xFF)
-        {
+        default:
+            rvalue = SD_OTHER_ERROR;
             break;
-        }
+    }
 
-        HAL_Time_Sleep_MicroSeconds(SPI_DELAY); 
+    // card holds DO low while programming
+    if(!SD_WaitReady(SD_WRITE_BUSY_TIMEOUT_USEC))
+    {
+        return SD_OTHER_ERROR;
     }
 
     return rvalue;
@@ -317,6 +660,11 @@ BOOL SD_BS_Driver::ChipInitialize(void *context)
     UINT32 clkNormal = g_SD_BL_Config.SPI.Clock_RateKHz;
     
     g_SD_BL_Config.SPI.Clock_RateKHz = 400; // initialization clock speed
+
+    // whatever is cached belongs to the previous card
+    SD_BS_Cache_Invalidate();
+
+    s_cacheFlushCompletion.InitializeForUserMode(SD_Cache_AgeFlush, NULL);
     
     //one test for insert \ eject ISR
     if(g_SD_BL_Config.InsertIsrPin != GPIO_PIN_NONE)
@@ -329,9 +677,12 @@ BOOL SD_BS_Driver::ChipInitialize(void *context)
     }
 
     CPU_SPI_Initialize();
-    GLOBAL_LOCK(irq);
 
-    CPU_SPI_Xaction_Start(g_SD_BL_Config.SPI);
+    if(!SD_BusAcquire())
+    {
+        g_SD_BL_Config.SPI.Clock_RateKHz = clkNormal;
+        return FALSE;
+    }
 
     BYTE response;
 
@@ -628,7 +979,7 @@ BOOL SD_BS_Driver::ChipInitialize(void *context)
     // Clean up and deselect SD card.
     
     SD_CsSetHigh();
-    CPU_SPI_Xaction_Stop(g_SD_BL_Config.SPI);
+    SD_BusRelease();
     g_SD_BL_Config.SPI.Clock_RateKHz = clkNormal;
     
     return isInitialised;
@@ -800,19 +1151,53 @@ BOOL SD_BS_Driver::SD_Set_In_READY_STATUS(BOOL isHC_XC_Supported)
 }
 
 
-void SD_BS_Driver::InsertISR(GPIO_PIN Pin, BOOL PinState, void* Param)
+static HAL_CONTINUATION s_insertContinuation;
+static HAL_CONTINUATION s_ejectContinuation;
+
+static void SD_Insert(void* arg)
 {
     FS_MountVolume("SD1", 0, 0, g_SD_BL_Config.Device);
 }
 
-void SD_BS_Driver::EjectISR(GPIO_PIN Pin, BOOL PinState, void* Param)
+// nothing is written back on eject, the card may already be off the bus
+static void SD_Eject(void* arg)
 {
+    UINT32 lost = SD_BS_Cache_Invalidate();
+
+    if(lost != 0)
+    {
+        debug_printf("SD: card removed, %d cached sectors not written\r\n", lost);
+    }
+
     FS_UnmountVolume(g_SD_BL_Config.Device);
 }
 
+// the card may be in the middle of a transfer, so the volume is (un)mounted from thread context
+void SD_BS_Driver::InsertISR(GPIO_PIN Pin, BOOL PinState, void* Param)
+{
+    if(!s_insertContinuation.IsLinked())
+    {
+        s_insertContinuation.InitializeCallback(SD_Insert, NULL);
+        s_insertContinuation.Enqueue();
+    }
+}
+
+void SD_BS_Driver::EjectISR(GPIO_PIN Pin, BOOL PinState, void* Param)
+{
+    if(!s_ejectContinuation.IsLinked())
+    {
+        s_ejectContinuation.InitializeCallback(SD_Eject, NULL);
+        s_ejectContinuation.Enqueue();
+    }
+}
+
 BOOL SD_BS_Driver::ChipUnInitialize(void *context)
 {
-    return TRUE;
+    BOOL fResult = SD_BS_Cache_Flush();
+
+    SD_BS_Cache_Invalidate();
+
+    return fResult;
 }
 
 BOOL SD_BS_Driver::ReadProductID(void *context, BYTE *ManufacturerCode, BYTE *OEMID, BYTE *ProductName)
@@ -820,8 +1205,10 @@ BOOL SD_BS_Driver::ReadProductID(void *context, BYTE *ManufacturerCode, BYTE *OE
     BYTE regCID[16];
     BYTE response;
    
-  	GLOBAL_LOCK(irq);
-    CPU_SPI_Xaction_Start(g_SD_BL_Config.SPI);
+    if(!SD_BusAcquire())
+    {
+        return FALSE;
+    }
 
     // enable SD card
     SD_CsSetLow();
@@ -832,7 +1219,7 @@ BOOL SD_BS_Driver::ReadProductID(void *context, BYTE *ManufacturerCode, BYTE *OE
     if(response != SD_START_DATA_BLOCK_TOKEN)
     {
         SD_CsSetHigh();
-        CPU_SPI_Xaction_Stop(g_SD_BL_Config.SPI);
+        SD_BusRelease();
         return FALSE;
     }
     else
@@ -865,11 +1252,11 @@ BOOL SD_BS_Driver::ReadProductID(void *context, BYTE *ManufacturerCode, BYTE *OE
 
     memcpy(ProductName, &regCID[3], 5);
 
-    CPU_SPI_Xaction_Stop(g_SD_BL_Config.SPI);
-
     // disable SD card
     SD_CsSetHigh();
 
+    SD_BusRelease();
+
     return TRUE;
 }
 
@@ -894,8 +1281,13 @@ BOOL SD_BS_Driver::ReadSector(SectorAddress sectorAddress, UINT32 Offset, UINT32
         // enable SD card
         SD_CsSetLow();
 
-        // send CMD17 and wait for DATA_BLOCK_TOKEN
-        response = SD_SendCmdWithR1Resp(SD_READ_SINGLE_BLOCK, sectorAddress << 9, 0xff, SD_START_DATA_BLOCK_TOKEN, 10000);
+        // send CMD17, then wait for DATA_BLOCK_TOKEN for at most Nac
+        response = SD_SendCmdWithR1Resp(SD_READ_SINGLE_BLOCK, sectorAddress << 9, 0xff, R1_IN_READY_STATUS, SD_CMD_RESPONSE_BYTES);
+
+        if(response == R1_IN_READY_STATUS)
+        {
+            response = SD_WaitToken(SD_READ_TOKEN_TIMEOUT_USEC);
+        }
 
         if(response == SD_START_DATA_BLOCK_TOKEN)
         {
@@ -934,6 +1326,52 @@ BOOL SD_BS_Driver::ReadSector(SectorAddress sectorAddress, UINT32 Offset, UINT32
     SD_CsSetHigh();
     return TRUE;
 }
+// Reads a run of whole sectors with one READ_MULTIPLE_BLOCK, ended by STOP_TRANSMISSION.
+static BOOL SD_ReadSectorRun(SectorAddress sectorAddress, UINT32 SectorCount, BYTE* pBuff, UINT32 BytesPerSector)
+{
+    BYTE response;
+    BOOL fResult = TRUE;
+
+    SD_BS_Driver::SD_CsSetLow();
+
+    response = SD_BS_Driver::SD_SendCmdWithR1Resp(SD_READ_MULTIPLE_BLOCK, sectorAddress << 9, 0xff, R1_IN_READY_STATUS, SD_CMD_RESPONSE_BYTES);
+
+    if(response != R1_IN_READY_STATUS)
+    {
+        SD_BS_Driver::SD_CsSetHigh();
+        return FALSE;
+    }
+
+    while(SectorCount--)
+    {
+        if(SD_WaitToken(SD_READ_TOKEN_TIMEOUT_USEC) != SD_START_DATA_BLOCK_TOKEN)
+        {
+            fResult = FALSE;
+            break;
+        }
+
+        SD_BS_Driver::SPIRecvCount(pBuff, BytesPerSector, 0);
+
+        // receive 16 bit CRC
+        SD_BS_Driver::SPISendByte(DUMMY);
+        SD_BS_Driver::SPISendByte(DUMMY);
+
+        pBuff += BytesPerSector;
+    }
+
+    // the byte following CMD12 is a stuff byte, the R1 response comes after it
+    SD_BS_Driver::SD_SendCmdWithR1Resp(SD_STOP_TRANSMISSION, 0, 0xff, R1_IN_READY_STATUS, SD_CMD_RESPONSE_BYTES + 1);
+
+    if(!SD_WaitReady(SD_READ_TOKEN_TIMEOUT_USEC))
+    {
+        fResult = FALSE;
+    }
+
+    SD_BS_Driver::SD_CsSetHigh();
+
+    return fResult;
+}
+
 #define DUMP_BUFFER_SIZE 16384
 
 #if defined(SD_DEBUG)	
@@ -1002,17 +1440,60 @@ BOOL SD_BS_Driver::Read(void *context, ByteAddress phyAddress, UINT32 NumBytes,
 
         UINT32 bytes  = (NumBytes + offset > BytesPerSector ? BytesPerSector - offset : NumBytes);
 
-		    GLOBAL_LOCK(irq);
-
-        CPU_SPI_Xaction_Start(g_SD_BL_Config.SPI);
+        if(!SD_BusAcquire())
+        {
+            return FALSE;
+        }
 
         while(NumBytes > 0)
         {
-            if(!ReadSector(StartSector, offset, bytes, pBuf, BytesPerSector))
+            UINT32 run = (offset == 0) ? NumBytes / BytesPerSector : 0;
+
+            if(run >= SD_MIN_SECTOR_RUN)
             {
-                CPU_SPI_Xaction_Stop(g_SD_BL_Config.SPI);
+                // contiguous whole sectors go out as a single multiple block read
+                if(!SD_ReadSectorRun(StartSector, run, (BYTE*)pBuf, BytesPerSector))
+                {
+                    SD_BusRelease();
 
-                return FALSE;
+                    return FALSE;
+                }
+
+                // sectors still dirty in the cache are newer than the card
+                SD_Cache_Patch(StartSector, run, (BYTE*)pBuf);
+
+                bytes        = run * BytesPerSector;
+                StartSector += run - 1;
+            }
+            else
+            {
+                SD_CACHE_ENTRY* pEntry = SD_Cache_Find(StartSector);
+
+                if(pEntry == NULL && bytes == BytesPerSector)
+                {
+                    // a whole sector miss goes straight to the caller rather than evicting
+                    s_cacheMisses++;
+
+                    if(!ReadSector(StartSector, 0, BytesPerSector, pBuf, BytesPerSector))
+                    {
+                        SD_BusRelease();
+
+                        return FALSE;
+                    }
+                }
+                else
+                {
+                    pEntry = SD_Cache_Get(StartSector, TRUE);
+
+                    if(pEntry == NULL)
+                    {
+                        SD_BusRelease();
+
+                        return FALSE;
+                    }
+
+                    memcpy(pBuf, &pEntry->Data[offset], bytes);
+                }
             }
             
             offset    = 0;
@@ -1023,7 +1504,7 @@ BOOL SD_BS_Driver::Read(void *context, ByteAddress phyAddress, UINT32 NumBytes,
             bytes = __min(BytesPerSector, NumBytes);
         }
 
-        CPU_SPI_Xaction_Stop(g_SD_BL_Config.SPI);
+        SD_BusRelease();
         
         return TRUE;
     }
@@ -1047,6 +1528,62 @@ BOOL SD_BS_Driver::Memset(void *context, ByteAddress phyAddr, UINT8 Data, UINT32
     return WriteX( context, phyAddr, NumBytes, &Data, TRUE, FALSE );
 }
 
+// Writes a run of whole sectors with one WRITE_MULTIPLE_BLOCK, ended by the stop token.
+// ACMD23 tells the card how many blocks follow so it can pre-erase them.
+static BOOL SD_WriteSectorRun(SectorAddress sectorAddress, UINT32 SectorCount, BYTE* pBuff, UINT32 BytesPerSector)
+{
+    BYTE response;
+    BOOL fResult = TRUE;
+
+    SD_BS_Driver::SD_CsSetLow();
+
+    // pre-erase hint; a card that does not support it just ignores it
+    SD_BS_Driver::SD_SendCmdWithR1Resp(SD_APP_CMD, 0, 0xff, R1_IN_READY_STATUS, SD_CMD_RESPONSE_BYTES);
+    SD_BS_Driver::SD_SendCmdWithR1Resp(SD_SET_WR_BLK_ERASE_COUNT, SectorCount & 0x007FFFFF, 0xff, R1_IN_READY_STATUS, SD_CMD_RESPONSE_BYTES);
+
+    response = SD_BS_Driver::SD_SendCmdWithR1Resp(SD_WRITE_MULTIPLE_BLOCK, sectorAddress << 9, 0xff, R1_IN_READY_STATUS, SD_CMD_RESPONSE_BYTES);
+
+    if(response != R1_IN_READY_STATUS)
+    {
+        SD_BS_Driver::SD_CsSetHigh();
+        return FALSE;
+    }
+
+    while(SectorCount--)
+    {
+        SD_BS_Driver::SPISendByte(DUMMY); // Nwr
+        SD_BS_Driver::SPISendByte(SD_START_MULTI_WRITE_TOKEN);
+
+        SD_BS_Driver::SPISendCount(pBuff, BytesPerSector);
+
+        // send CRC
+        SD_BS_Driver::SPISendByte(0xff);
+        SD_BS_Driver::SPISendByte(0xff);
+
+        // data response, then wait for end of write busy
+        if(SD_BS_Driver::SD_CheckBusy() != SD_SUCCESS)
+        {
+            fResult = FALSE;
+            break;
+        }
+
+        pBuff += BytesPerSector;
+    }
+
+    // stop token, the card goes busy once more after the stuff byte
+    SD_BS_Driver::SPISendByte(SD_STOP_TRAN_TOKEN);
+    SD_BS_Driver::SPISendByte(DUMMY);
+
+    if(!SD_WaitReady(SD_WRITE_BUSY_TIMEOUT_USEC))
+    {
+        fResult = FALSE;
+    }
+
+    SD_BS_Driver::SD_CsSetHigh();
+
+    return fResult;
+}
+
 BOOL SD_BS_Driver::WriteX(void *context, ByteAddress phyAddr, UINT32 NumBytes, BYTE *pSectorBuff, BOOL ReadModifyWrite, BOOL fIncrementDataPtr )
 {
     NATIVE_PROFILE_PAL_FLASH();
@@ -1056,11 +1593,10 @@ BOOL SD_BS_Driver::WriteX(void *context, ByteAddress phyAddr, UINT32 NumBytes, B
     UINT32 BytesPerSector;
     UINT32 offset;
     UINT32 bytes;
-    BYTE response;
 
     BLOCK_CONFIG* pConfig = (BLOCK_CONFIG*)context;
 
-    CHIP_WORD *pData, *pWrite;
+    CHIP_WORD *pData;
 
     // find the corresponding region     
     if(!pConfig->BlockDeviceInformation->FindRegionFromAddress(phyAddr, RegionIndex, RangeIndex))
@@ -1071,69 +1607,67 @@ BOOL SD_BS_Driver::WriteX(void *context, ByteAddress phyAddr, UINT32 NumBytes, B
     pData = (CHIP_WORD*)pSectorBuff;
     BytesPerSector = pConfig->BlockDeviceInformation->BytesPerSector;
 
-    GLOBAL_LOCK(irq);
-
     offset = phyAddr - (StartSector * BytesPerSector);
 
     bytes = (NumBytes + offset > BytesPerSector ? BytesPerSector - offset : NumBytes);
 
-    CPU_SPI_Xaction_Start(g_SD_BL_Config.SPI);
+    if(!SD_BusAcquire())
+    {
+        return FALSE;
+    }
 
     while(NumBytes > 0)
     {
-        // if we are using memset, or if the bytes written are less than the BytesPerSector then do read/modify/write
-        if(!fIncrementDataPtr || (bytes != BytesPerSector))
-        {   
-            if(bytes != BytesPerSector)
+        UINT32 run = (fIncrementDataPtr && offset == 0) ? NumBytes / BytesPerSector : 0;
+
+        if(run >= SD_MIN_SECTOR_RUN)
+        {
+            // contiguous whole sectors go out as a single multiple block write
+            SD_Cache_Discard(StartSector, run);
+
+            if(!SD_WriteSectorRun(StartSector, run, (BYTE*)pData, BytesPerSector))
             {
-                if(!ReadSector(StartSector, 0, BytesPerSector, s_sectorBuff, BytesPerSector))
-                {
-                    CPU_SPI_Xaction_Stop(g_SD_BL_Config.SPI);
-                    return FALSE;
-                }
+                SD_BusRelease();
+                return FALSE;
+            }
+
+            pData        = (CHIP_WORD*)((UINT32)pData + run * BytesPerSector);
+            NumBytes    -= run * BytesPerSector;
+            StartSector += run;
+            bytes = __min(BytesPerSector, NumBytes);
+            continue;
+        }
 
+        SD_CACHE_ENTRY* pEntry = SD_Cache_Find(StartSector);
+
+        // memset and partial sectors are merged in the cache, as is anything already cached
+        if(!fIncrementDataPtr || (bytes != BytesPerSector) || (pEntry != NULL))
+        {   
+            pEntry = SD_Cache_Get(StartSector, bytes != BytesPerSector);
+
+            if(pEntry == NULL)
+            {
+                SD_BusRelease();
+                return FALSE;
             }
-            
-            pWrite = (CHIP_WORD*)&s_sectorBuff[0];
 
             if(fIncrementDataPtr)
             {
-                memcpy(&pWrite[offset], pData, bytes);
+                memcpy(&pEntry->Data[offset], pData, bytes);
             }
             else
             {
-                memset(&pWrite[offset], *pData, bytes);
+                memset(&pEntry->Data[offset], *pData, bytes);
             }
-        }
-        else
-        {
-            pWrite = pData;
-        }
 
-        // select SD CS
-        SD_CsSetLow();
-        
-        // send CMD24 --read single block data
-        response = SD_SendCmdWithR1Resp(SD_WRITE_SINGLE_BLOCK, StartSector << 9, 0xff, R1_IN_READY_STATUS);
-
-        if(response == R1_IN_READY_STATUS)
+            SD_Cache_MarkDirty(pEntry);
+        }
+        else if(!SD_WriteSector(StartSector, (BYTE*)pData, BytesPerSector))
         {
-            SPISendByte(SD_START_DATA_BLOCK_TOKEN); // send DATA_BLOCK_TOKEN
-
-            // send data
-            SPISendCount(pWrite, BytesPerSector);
-
-            // send CRC
-            SPISendByte(0xff);
-            SPISendByte(0xff);
-
-            // wait for end of write busy
-            response = SD_CheckBusy();
+            SD_BusRelease();
+            return FALSE;
         }
 
-        //disable SD card CS
-        SD_CsSetHigh();
-
         if(fIncrementDataPtr) pData = (CHIP_WORD*)((UINT32)pData + bytes);
 
         NumBytes   -= bytes;
@@ -1142,7 +1676,7 @@ BOOL SD_BS_Driver::WriteX(void *context, ByteAddress phyAddr, UINT32 NumBytes, B
         bytes = __min(BytesPerSector, NumBytes);        
     }
 
-    CPU_SPI_Xaction_Stop(g_SD_BL_Config.SPI);
+    SD_BusRelease();
 
     return TRUE;
 
@@ -1238,12 +1772,12 @@ BOOL SD_BS_Driver::EraseSectors(SectorAddress Address, INT32 SectorCount)
         return FALSE;
     }
 
-    // wait for IDLE
-    SD_CheckBusy();
+    // card holds DO low until the erase is done
+    BOOL fReady = SD_WaitReady(SD_ERASE_BUSY_TIMEOUT_USEC);
 
     SD_CsSetHigh();
 
-    return TRUE;
+    return fReady;
 
 }
 
@@ -1267,13 +1801,16 @@ BOOL SD_BS_Driver::EraseBlock(void *context, ByteAddress phyAddr)
 
     SectorAddress SectorAddress = (StartSector / SectorsPerBlock) * SectorsPerBlock;
 
-	GLOBAL_LOCK(irq);
+    if(!SD_BusAcquire())
+    {
+        return FALSE;
+    }
 
-    CPU_SPI_Xaction_Start(g_SD_BL_Config.SPI);
+    SD_Cache_Discard(SectorAddress, SectorsPerBlock);
 
     EraseSectors(SectorAddress, SectorsPerBlock);
 
-    CPU_SPI_Xaction_Stop(g_SD_BL_Config.SPI);
+    SD_BusRelease();
 
     return TRUE;
 
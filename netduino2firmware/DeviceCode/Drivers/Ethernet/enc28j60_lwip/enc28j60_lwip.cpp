@@ -54,6 +54,12 @@ void    enc28j60_lwip_read_spi(SPI_CONFIGURATION *spiConf,
 void    enc28j60_lwip_select_bank(SPI_CONFIGURATION *spiConf, 
                                        UINT8 bankNumber);
 
+void    enc28j60_lwip_begin_batch(SPI_CONFIGURATION *spiConf);
+
+void    enc28j60_lwip_end_batch(SPI_CONFIGURATION *spiConf);
+
+void    enc28j60_lwip_deliver( struct netif *pNetIF );
+
 void    enc28j60_lwip_write_phy_register(SPI_CONFIGURATION *spiConf, 
                                               UINT8 registerAddress, 
                                               unsigned short data);
@@ -69,6 +75,43 @@ short   enc28j60_lwip_read_phy_register(SPI_CONFIGURATION *spiConf,
 static unsigned short s_ENC28J60_TRANSMIT_BUFFER_START = ENC28J60_TRANSMIT_BUFFER_START;
 static unsigned short s_ENC28J60_RECEIVE_BUFFER_START  = ENC28J60_RECEIVE_BUFFER_START;
 
+/* register access batching, see enc28j60_lwip_begin_batch */
+#define ENC28J60_BANK_UNKNOWN 0xFF
+static UINT8           s_ENC28J60_CURRENT_BANK = ENC28J60_BANK_UNKNOWN;
+static volatile UINT32 s_ENC28J60_BATCH_DEPTH  = 0;
+
+/* received frames waiting for lwIP, see enc28j60_lwip_recv */
+#ifndef ENC28J60_RX_QUEUE_SIZE
+#define ENC28J60_RX_QUEUE_SIZE 16
+#endif
+
+static struct pbuf* volatile s_ENC28J60_RX_QUEUE[ENC28J60_RX_QUEUE_SIZE];
+static volatile UINT32       s_ENC28J60_RX_HEAD = 0;   /* written by the producer only */
+static volatile UINT32       s_ENC28J60_RX_TAIL = 0;   /* written by the consumer only */
+static volatile UINT32       s_ENC28J60_IRQ_TICKS = 0;
+
+struct ENC28J60_LWIP_RX_STATS
+{
+    UINT32 Frames;              /* frames handed to lwIP */
+    UINT32 Overflows;           /* receive errors reported by the chip (buffer full) */
+    UINT32 Drops;               /* frames discarded, no pbuf or a corrupted buffer */
+    UINT32 LatencyMaxTicks;     /* worst time from the interrupt to lwIP input */
+    UINT64 LatencyTotalTicks;   /* sum over Frames */
+};
+
+ENC28J60_LWIP_RX_STATS g_ENC28J60_LWIP_RxStats;
+
+/* Bus and buffer cost; SpiCommands and PbufAllocs per (Frames + TxFrames) 
+   is the figure to compare across driver changes */
+struct ENC28J60_LWIP_IO_STATS
+{
+    UINT32 SpiCommands;         /* chip select windows */
+    UINT32 PbufAllocs;          /* pbufs allocated by the driver */
+    UINT32 TxFrames;            /* frames handed to the chip */
+};
+
+ENC28J60_LWIP_IO_STATS g_ENC28J60_LWIP_IoStats;
+
 
 /* ********************************************************************
    open the ENC28J60 driver interface.
@@ -188,6 +231,19 @@ void  enc28j60_lwip_pre_interrupt  (GPIO_PIN Pin, BOOL PinState, void* pArg )
     
     GLOBAL_LOCK(encIrq);
 
+    s_ENC28J60_IRQ_TICKS = (UINT32)HAL_Time_CurrentTicks();
+
+    /* The task level handler is talking to the chip; it services whatever 
+       raised this interrupt before it re-enables INTIE, so just queue it again.
+     */
+    if(s_ENC28J60_BATCH_DEPTH != 0)
+    {
+        lwip_interrupt_continuation( );
+        return;
+    }
+
+    enc28j60_lwip_begin_batch(SpiConf);
+
     /* After an interrupt occurs, the host controller should
         clear the global enable bit for the interrupt pin before
         servicing the interrupt. Clearing the enable bit will
@@ -208,6 +264,8 @@ void  enc28j60_lwip_pre_interrupt  (GPIO_PIN Pin, BOOL PinState, void* pArg )
         enc28j60_handle_xmit_error( pNetIF, SpiConf );
     }
 
+    enc28j60_lwip_end_batch(SpiConf);
+
     lwip_interrupt_continuation( );
 }
 
@@ -226,8 +284,6 @@ void enc28j60_lwip_interrupt( struct netif *pNetIF )
    
     SPI_CONFIGURATION  *SpiConf;
     
-    GLOBAL_LOCK(encIrq);
-    
     if (!pNetIF )
     {
         return;
@@ -235,6 +291,8 @@ void enc28j60_lwip_interrupt( struct netif *pNetIF )
     
     SpiConf = &g_ENC28J60_LWIP_Config.DeviceConfigs[0].SPI_Config;
     
+    enc28j60_lwip_begin_batch(SpiConf);
+    
     /* Is there an interrupt pending */
     enc28j60_lwip_read_spi(SpiConf,  ENC28J60_SPI_READ_CONTROL_REGISTER_OPCODE, ENC28J60_ESTAT, &status, 1, 0);
     
@@ -252,7 +310,7 @@ void enc28j60_lwip_interrupt( struct netif *pNetIF )
     /* Read the number of packets remaining */
     
     enc28j60_lwip_select_bank(SpiConf, ENC28J60_CONTROL_REGISTER_BANK1);
-    enc28j60_lwip_read_spi(SpiConf, ENC28J60_SPI_READ_BUFFER_MEMORY_OPCODE, ENC28J60_EPKTCNT, &cntPkts, 1, 0);  
+    enc28j60_lwip_read_spi(SpiConf, ENC28J60_SPI_READ_CONTROL_REGISTER_OPCODE, ENC28J60_EPKTCNT, &cntPkts, 1, 0);  
     
     
     if ((status & (1 << ENC28J60_ESTAT_INT)) || cntPkts)
@@ -274,6 +332,7 @@ void enc28j60_lwip_interrupt( struct netif *pNetIF )
         /* recover from rx error */
         if (eirData & (1 << ENC28J60_EIR_RXERIF_BIT))
         {
+            g_ENC28J60_LWIP_RxStats.Overflows++;
             enc28j60_handle_recv_error( pNetIF, SpiConf );
         }
 
@@ -306,6 +365,11 @@ void enc28j60_lwip_interrupt( struct netif *pNetIF )
     byteData = (1 << ENC28J60_EIE_INTIE_BIT); 
     enc28j60_lwip_write_spi(SpiConf, ENC28J60_SPI_BIT_FIELD_SET_OPCODE, ENC28J60_EIE, byteData); 
         
+    enc28j60_lwip_end_batch(SpiConf);
+    
+    /* the chip is released, now let lwIP have the frames */
+    enc28j60_lwip_deliver( pNetIF );
+    
     if (packetsLeft)
     {
         /* If there are more packets left re-queue the continuation */
@@ -316,32 +380,73 @@ void enc28j60_lwip_interrupt( struct netif *pNetIF )
 }
 
 /* ********************************************************************
-   Receive. a packet over the packet driver interface.  This is called
-   from the ISR or task ISR.
+   Receive. packets over the packet driver interface.  This is called
+   from the task level interrupt handler.
    
-   This routine is called when a packet is received. 
-    
-   Upon successful reading of received packet, the IP is
-   signalled to process the packet.
+   The number of waiting packets is read once and that many frames are
+   read back to back: the read pointer is set once and, as each frame is
+   read along with its CRC and padding, it is left on the next one.  The
+   frames are put on the receive queue for enc28j60_lwip_deliver, so the
+   chip buffer is freed before lwIP does any work.
    
    Returns the number of packets that remain to be processed
 
   ******************************************************************** */
+static BOOL enc28j60_rx_queue_put( struct pbuf *pPBuf )
+{
+    UINT32 head = s_ENC28J60_RX_HEAD;
+
+    if (head - s_ENC28J60_RX_TAIL >= ENC28J60_RX_QUEUE_SIZE)
+    {
+        return FALSE;
+    }
+
+    s_ENC28J60_RX_QUEUE[head % ENC28J60_RX_QUEUE_SIZE] = pPBuf;
+
+    /* publish the slot only once it is filled */
+    s_ENC28J60_RX_HEAD = head + 1;
+
+    return TRUE;
+}
+
+static struct pbuf* enc28j60_rx_queue_get( void )
+{
+    UINT32       tail = s_ENC28J60_RX_TAIL;
+    struct pbuf *pPBuf;
+
+    if (tail == s_ENC28J60_RX_HEAD)
+    {
+        return NULL;
+    }
+
+    pPBuf = s_ENC28J60_RX_QUEUE[tail % ENC28J60_RX_QUEUE_SIZE];
+
+    s_ENC28J60_RX_TAIL = tail + 1;
+
+    return pPBuf;
+}
+
+static void enc28j60_set_read_pointer( SPI_CONFIGURATION *SpiConf, UINT16 address )
+{
+    enc28j60_lwip_select_bank(SpiConf, ENC28J60_CONTROL_REGISTER_BANK0);
+    enc28j60_lwip_write_spi(SpiConf, ENC28J60_SPI_WRITE_CONTROL_REGISTER_OPCODE, ENC28J60_ERDPTL, (UINT8)(address & 0xFF));
+    enc28j60_lwip_write_spi(SpiConf, ENC28J60_SPI_WRITE_CONTROL_REGISTER_OPCODE, ENC28J60_ERDPTH, (UINT8)((address >> 8) & 0xFF));
+}
+
 int enc28j60_lwip_recv( struct netif *pNetIF )
 {
     NATIVE_PROFILE_HAL_DRIVERS_ETHERNET();
 
     struct pbuf        *pPBuf;
-    UINT8              *dataRX;
     UINT8               nextPktAndRecvStatusVector[6];
     UINT16              length;
+    UINT16              frameLength;
     UINT8               byteData;
     UINT8               packetsLeft;
     UINT16              lastReceiveBuffer;
+    UINT32              count;
     SPI_CONFIGURATION*  SpiConf;
     
-    int                     numPacketsProcessed = 0;
-    
     if ( !pNetIF )
     {
         return 1;
@@ -349,122 +454,258 @@ int enc28j60_lwip_recv( struct netif *pNetIF )
 
     SpiConf = &g_ENC28J60_LWIP_Config.DeviceConfigs[0].SPI_Config;
 
-    do 
+    enc28j60_lwip_begin_batch(SpiConf);
+
+    /* Snapshot the number of packets, no more than the queue can take */
+    enc28j60_lwip_select_bank(SpiConf, ENC28J60_CONTROL_REGISTER_BANK1);
+    enc28j60_lwip_read_spi(SpiConf, ENC28J60_SPI_READ_CONTROL_REGISTER_OPCODE, ENC28J60_EPKTCNT, &packetsLeft, 1, 0);   
+
+    count = ENC28J60_RX_QUEUE_SIZE - (s_ENC28J60_RX_HEAD - s_ENC28J60_RX_TAIL);
+
+    if (packetsLeft < count)
+    {
+        count = packetsLeft;
+    }
+
+    /* Set the read buffer pointer to the beginning of the first packet */
+    if (count)
     {
+        enc28j60_set_read_pointer(SpiConf, s_ENC28J60_RECEIVE_BUFFER_START);
+    }
+
+    while (count--)
+    {
+        /* Get the next packet pointer */
+        enc28j60_lwip_read_spi(SpiConf, ENC28J60_SPI_READ_BUFFER_MEMORY_OPCODE, 
+                            ENC28J60_SPI_READ_BUFFER_MEMORY_ARGUMENT, 
+                            nextPktAndRecvStatusVector, 6, 0);   
+        
+        lastReceiveBuffer = (nextPktAndRecvStatusVector[1] << 8) | nextPktAndRecvStatusVector[0];
+        length = (nextPktAndRecvStatusVector[3] << 8) | nextPktAndRecvStatusVector[2];
+
+        /* corrupted */
+        if(lastReceiveBuffer > ENC28J60_RECEIVE_BUFFER_END)
         {
-            /* Disable interrupt for each loop and only each loop */
-            GLOBAL_LOCK(encIrq);
-
-            /* Set the read buffer pointer to the beginning of the packet */
-            enc28j60_lwip_select_bank(SpiConf, ENC28J60_CONTROL_REGISTER_BANK0);
-            
-            byteData = s_ENC28J60_RECEIVE_BUFFER_START & 0xFF;
-            
-            enc28j60_lwip_write_spi(SpiConf, ENC28J60_SPI_WRITE_CONTROL_REGISTER_OPCODE, ENC28J60_ERDPTL, byteData);
-            
-            byteData = (s_ENC28J60_RECEIVE_BUFFER_START  >> 8) & 0xFF;
-            
-            enc28j60_lwip_write_spi(SpiConf, ENC28J60_SPI_WRITE_CONTROL_REGISTER_OPCODE, ENC28J60_ERDPTH, byteData);
-
-            /* Get the next packet pointer */
+            g_ENC28J60_LWIP_RxStats.Drops++;
+            enc28j60_handle_recv_error( pNetIF, SpiConf);
+            break;
+        }
+
+        /* the frame is followed by its CRC and padded to an even address */
+        pPBuf = (length != 0) ? pbuf_alloc( PBUF_RAW, length + (length & 1), PBUF_RAM ) : NULL;
+        
+        if ( pPBuf )
+        {
+            g_ENC28J60_LWIP_IoStats.PbufAllocs++;
+
+            /* Get the packet, which leaves the read pointer on the next one */
             enc28j60_lwip_read_spi(SpiConf, ENC28J60_SPI_READ_BUFFER_MEMORY_OPCODE, 
-                                ENC28J60_SPI_READ_BUFFER_MEMORY_ARGUMENT, 
-                                nextPktAndRecvStatusVector, 6, 0);   
-            
-            lastReceiveBuffer = (nextPktAndRecvStatusVector[1] << 8) | nextPktAndRecvStatusVector[0];
-            length = (nextPktAndRecvStatusVector[3] << 8) | nextPktAndRecvStatusVector[2];
-
-            /* corrupted */
-            if(lastReceiveBuffer > ENC28J60_RECEIVE_BUFFER_END)
-            {
-                enc28j60_handle_recv_error( pNetIF, SpiConf);
-                packetsLeft = 0;
-                break;
-            }
-            else
-            {
-                s_ENC28J60_RECEIVE_BUFFER_START = lastReceiveBuffer;
-            }
+                            ENC28J60_SPI_READ_BUFFER_MEMORY_ARGUMENT, 
+                            (UINT8 *)pPBuf->payload, 
+                            length + (length & 1), 
+                            0);   
 
+            //remove the checksum trailing bytes
+            frameLength = (length > 63) ? length - 4 : length;
+
+            pbuf_realloc( pPBuf, frameLength );
+
+            /* room was checked before the loop */
+            enc28j60_rx_queue_put( pPBuf );
+        }
+        else
+        {
             if (length != 0)
             {
-                pPBuf = pbuf_alloc( PBUF_RAW, length, PBUF_RAM );
-                
-                if ( pPBuf )
-                {
-                   dataRX = (UINT8 *)pPBuf->payload;
-
-                    //remove the checksum trailing bytes
-                    if (length > 63)
-                    {
-                        length -= 4;
-                    }
-                    
-                    /* Get the packet */
-                    enc28j60_lwip_read_spi(SpiConf, ENC28J60_SPI_READ_BUFFER_MEMORY_OPCODE, 
-                                    ENC28J60_SPI_READ_BUFFER_MEMORY_ARGUMENT, 
-                                    dataRX, 
-                                    length, 
-                                    0);   
-                
-                    /* invoke stack ip input - the stack should free the buffer when it is done,
-                                        so DON'T call pbuf_free on pPBuf!!!!!*/
-                    pNetIF->input( pPBuf, pNetIF );
-                }
-                else
-                {
-                    hal_printf("enc28j60_lwip_recv: input alloc packet failed \r\n");
-                }   
-            }
-            else // no packets left - should we break??
-            {
+                g_ENC28J60_LWIP_RxStats.Drops++;
             }
 
-            if(0 == (s_ENC28J60_RECEIVE_BUFFER_START % 2))
+            /* skip the frame */
+            enc28j60_set_read_pointer(SpiConf, lastReceiveBuffer);
+        }
+
+        s_ENC28J60_RECEIVE_BUFFER_START = lastReceiveBuffer;
+
+        if(0 == (s_ENC28J60_RECEIVE_BUFFER_START % 2))
+        {
+            /* from errata rev.b5 - circular buffer doesn't handle even numbers well -> nextPkt is guarranteed to be even */
+            if(((s_ENC28J60_RECEIVE_BUFFER_START - 1) < ENC28J60_RECEIVE_BUFFER_START) || 
+                ((s_ENC28J60_RECEIVE_BUFFER_START - 1) > ENC28J60_RECEIVE_BUFFER_END))
             {
-                /* from errata rev.b5 - circular buffer doesn't handle even numbers well -> nextPkt is guarranteed to be even */
-                if(((s_ENC28J60_RECEIVE_BUFFER_START - 1) < ENC28J60_RECEIVE_BUFFER_START) || 
-                    ((s_ENC28J60_RECEIVE_BUFFER_START - 1) > ENC28J60_RECEIVE_BUFFER_END))
-                {
-                    lastReceiveBuffer = ENC28J60_RECEIVE_BUFFER_END;
-                }
-                else
-                {
-                    lastReceiveBuffer = s_ENC28J60_RECEIVE_BUFFER_START - 1;
-                }
+                lastReceiveBuffer = ENC28J60_RECEIVE_BUFFER_END;
             }
             else
-            {
-                lastReceiveBuffer = s_ENC28J60_RECEIVE_BUFFER_START;
-            }
-
-            /* Free the packet from the ethernet */            
-            byteData = lastReceiveBuffer & 0xFF;
-            enc28j60_lwip_write_spi(SpiConf, ENC28J60_SPI_WRITE_CONTROL_REGISTER_OPCODE, ENC28J60_ERXRDPTL, byteData);
-            
-            byteData = lastReceiveBuffer >> 8;
-            enc28j60_lwip_write_spi(SpiConf, ENC28J60_SPI_WRITE_CONTROL_REGISTER_OPCODE, ENC28J60_ERXRDPTH, byteData);
-                                  
-            /* the host controller must write a 1 to the ECON2.PKTDEC bit. 
-                         Doing so will cause the EPKTCNT register to decrement by 1 */
-            byteData = (1 << ENC28J60_ECON2_PKTDEC_BIT);
-            enc28j60_lwip_write_spi(SpiConf, ENC28J60_SPI_BIT_FIELD_SET_OPCODE, ENC28J60_ECON2, byteData); 
-            
-            /* Read the number of packets remaining*/
-            enc28j60_lwip_select_bank(SpiConf, ENC28J60_CONTROL_REGISTER_BANK1);
-            enc28j60_lwip_read_spi(SpiConf, ENC28J60_SPI_READ_BUFFER_MEMORY_OPCODE, ENC28J60_EPKTCNT, &packetsLeft, 1, 0);   
-
-            if ( (++numPacketsProcessed > CFG_MAX_PACKETS_PROCESSED) && packetsLeft)
             {
-                break;
+                lastReceiveBuffer = s_ENC28J60_RECEIVE_BUFFER_START - 1;
             }
         }
-    } while (packetsLeft);    
+
+        /* Free the packet from the ethernet */            
+        enc28j60_lwip_select_bank(SpiConf, ENC28J60_CONTROL_REGISTER_BANK0);
+
+        byteData = lastReceiveBuffer & 0xFF;
+        enc28j60_lwip_write_spi(SpiConf, ENC28J60_SPI_WRITE_CONTROL_REGISTER_OPCODE, ENC28J60_ERXRDPTL, byteData);
+        
+        byteData = lastReceiveBuffer >> 8;
+        enc28j60_lwip_write_spi(SpiConf, ENC28J60_SPI_WRITE_CONTROL_REGISTER_OPCODE, ENC28J60_ERXRDPTH, byteData);
+                              
+        /* the host controller must write a 1 to the ECON2.PKTDEC bit. 
+                     Doing so will cause the EPKTCNT register to decrement by 1 */
+        byteData = (1 << ENC28J60_ECON2_PKTDEC_BIT);
+        enc28j60_lwip_write_spi(SpiConf, ENC28J60_SPI_BIT_FIELD_SET_OPCODE, ENC28J60_ECON2, byteData); 
+    }
+
+    /* Read the number of packets remaining, including any that arrived meanwhile */
+    enc28j60_lwip_select_bank(SpiConf, ENC28J60_CONTROL_REGISTER_BANK1);
+    enc28j60_lwip_read_spi(SpiConf, ENC28J60_SPI_READ_CONTROL_REGISTER_OPCODE, ENC28J60_EPKTCNT, &packetsLeft, 1, 0);   
+
+    enc28j60_lwip_end_batch(SpiConf);
         
     return packetsLeft;
     
 }
+
+/* ********************************************************************
+   Hand the received frames to lwIP.  Must not be called inside a 
+   register batch, lwIP may transmit from its input function.
+   
+  ******************************************************************** */
+void enc28j60_lwip_deliver( struct netif *pNetIF )
+{
+    struct pbuf *pPBuf;
+    UINT32       latency;
+
+    while ((pPBuf = enc28j60_rx_queue_get()) != NULL)
+    {
+        latency = (UINT32)HAL_Time_CurrentTicks() - s_ENC28J60_IRQ_TICKS;
+
+        if (latency > g_ENC28J60_LWIP_RxStats.LatencyMaxTicks)
+        {
+            g_ENC28J60_LWIP_RxStats.LatencyMaxTicks = latency;
+        }
+
+        g_ENC28J60_LWIP_RxStats.LatencyTotalTicks += latency;
+        g_ENC28J60_LWIP_RxStats.Frames++;
+
+        /* invoke stack ip input - the stack should free the buffer when it is done,
+                            so DON'T call pbuf_free on pPBuf!!!!!*/
+        pNetIF->input( pPBuf, pNetIF );
+    }
+}
     
+/* ********************************************************************
+   Write a frame into the transmit buffer at EWRPT.
+   
+   The WBM opcode, the per packet control byte and then every pbuf
+   segment are clocked out inside one chip select window of the current
+   register batch, so the frame
+   is sent straight from the pbuf chain without a copy. A frame shorter
+   than length is padded with zeros.
+   
+   Defining ENC28J60_LWIP_XMIT_COPY selects the former path, which
+   gathers the frame into a single pbuf before sending it.
+   
+   Returns FALSE if no buffer could be allocated (copy path only)
+   
+  ******************************************************************** */
+#if !defined(ENC28J60_LWIP_XMIT_COPY)
+
+static UINT8 s_ENC28J60_ZERO_PAD[ETHER_MIN_LEN];
+
+static BOOL enc28j60_lwip_write_frame(SPI_CONFIGURATION *SpiConf, UINT8 perPacketControlByte, struct pbuf *pPBuf, UINT16 length)
+{
+    SPI_XACTION_8   xaction;
+    UINT8           header[2];
+    UINT16          segment;
+
+    header[0] = ENC28J60_SPI_OPCODE_ARGUMENT(ENC28J60_SPI_WRITE_BUFFER_MEMORY_OPCODE, ENC28J60_SPI_WRITE_BUFFER_MEMORY_ARGUMENT);
+    header[1] = perPacketControlByte;
+
+    xaction.Read8           = NULL;
+    xaction.ReadCount       = 0;
+    xaction.ReadStartOffset = 0;
+    xaction.SPI_mod         = SpiConf->SPI_mod;
+    xaction.BusyPin.Pin     = GPIO_PIN_NONE;
+
+    g_ENC28J60_LWIP_IoStats.SpiCommands++;
+
+    enc28j60_lwip_begin_batch(SpiConf);
+    CPU_GPIO_SetPinState(SpiConf->DeviceCS, SpiConf->CS_Active);
+
+    xaction.Write8     = header;
+    xaction.WriteCount = 2;
+    CPU_SPI_Xaction_nWrite8_nRead8(xaction);
+
+    while(pPBuf && length)
+    {
+        segment = (pPBuf->len < length) ? pPBuf->len : length;
+
+        if(segment)
+        {
+            xaction.Write8     = (UINT8*)pPBuf->payload;
+            xaction.WriteCount = segment;
+            CPU_SPI_Xaction_nWrite8_nRead8(xaction);
+        }
+
+        length -= segment;
+        pPBuf   = pPBuf->next;
+    }
+
+    /* only frames below ETHER_MIN_LEN are short of length */
+    if(length)
+    {
+        xaction.Write8     = s_ENC28J60_ZERO_PAD;
+        xaction.WriteCount = length;
+        CPU_SPI_Xaction_nWrite8_nRead8(xaction);
+    }
+
+    CPU_GPIO_SetPinState(SpiConf->DeviceCS, !SpiConf->CS_Active);
+    enc28j60_lwip_end_batch(SpiConf);
+
+    return TRUE;
+}
+
+#else
+
+static BOOL enc28j60_lwip_write_frame(SPI_CONFIGURATION *SpiConf, UINT8 perPacketControlByte, struct pbuf *pPBuf, UINT16 length)
+{
+    struct pbuf*            pTmp;
+    UINT8*                  pTx;
+    int                     idx;
+
+    pTmp = pbuf_alloc(PBUF_RAW, length + 2, PBUF_RAM);
+
+    if(!pTmp) return FALSE;
+
+    g_ENC28J60_LWIP_IoStats.PbufAllocs++;
+
+    pTx = (UINT8*)pTmp->payload;
+
+    pTx[0] = ENC28J60_SPI_OPCODE_ARGUMENT(ENC28J60_SPI_WRITE_BUFFER_MEMORY_OPCODE, ENC28J60_SPI_WRITE_BUFFER_MEMORY_ARGUMENT);
+    pTx[1] = perPacketControlByte;
+
+    idx = 2;
+
+    while(pPBuf)
+    {
+        memcpy(&pTx[idx], pPBuf->payload, pPBuf->len);
+
+        idx += pPBuf->len;
+        
+        pPBuf = pPBuf->next;
+    }
+
+    g_ENC28J60_LWIP_IoStats.SpiCommands++;
+
+    CPU_SPI_nWrite8_nRead8(*SpiConf, pTx, length+2, 0, 0, 0 );
+
+    pbuf_free(pTmp);
+
+    return TRUE;
+}
+
+#endif
+
 /* ********************************************************************
    Transmit. a packet over the packet driver interface.
    
@@ -483,9 +724,6 @@ err_t enc28j60_lwip_xmit( struct netif *pNetIF, struct pbuf *pPBuf)
     UINT8                   perPacketControlByte;
     UINT8                   dataByte;
     SPI_CONFIGURATION*      SpiConf;
-    struct pbuf*            pTmp;
-    UINT8*                  pTx;
-    int                     idx;
     
         
     GLOBAL_LOCK(encIrq);
@@ -497,6 +735,7 @@ err_t enc28j60_lwip_xmit( struct netif *pNetIF, struct pbuf *pPBuf)
     
     SpiConf = &g_ENC28J60_LWIP_Config.DeviceConfigs[0].SPI_Config;
 
+    enc28j60_lwip_begin_batch(SpiConf);
      
     enc28j60_lwip_read_spi(SpiConf, ENC28J60_SPI_READ_CONTROL_REGISTER_OPCODE, ENC28J60_ECON1, &dataByte, 1, 0);
 
@@ -557,31 +796,15 @@ err_t enc28j60_lwip_xmit( struct netif *pNetIF, struct pbuf *pPBuf)
                            (1 << ENC28J60_XMIT_CONTROL_PCRCEN_BIT) ;
 
 
-    pTmp = pbuf_alloc(PBUF_RAW, length + 2, PBUF_RAM);
-
-    if(!pTmp) return ERR_MEM;
-
-    pTx = (UINT8*)pTmp->payload;
-
-    pTx[0] = ENC28J60_SPI_OPCODE_ARGUMENT(ENC28J60_SPI_WRITE_BUFFER_MEMORY_OPCODE, ENC28J60_SPI_WRITE_BUFFER_MEMORY_ARGUMENT);
-    pTx[1] = perPacketControlByte;
-
-    idx = 2;
-
-    while(pPBuf)
+    if(!enc28j60_lwip_write_frame(SpiConf, perPacketControlByte, pPBuf, length))
     {
-        memcpy(&pTx[idx], pPBuf->payload, pPBuf->len);
-
-        idx += pPBuf->len;
-        
-        pPBuf = pPBuf->next;
+        enc28j60_lwip_end_batch(SpiConf);
+        return ERR_MEM;
     }
 
-    CPU_SPI_nWrite8_nRead8(*SpiConf, pTx, length+2, 0, 0, 0 );
-
-    pbuf_free(pTmp);
-
     s_ENC28J60_TRANSMIT_BUFFER_START += length;
+
+    g_ENC28J60_LWIP_IoStats.TxFrames++;
     
     /* 3. */
     /* Making sure to select the right bank */
@@ -609,6 +832,8 @@ err_t enc28j60_lwip_xmit( struct netif *pNetIF, struct pbuf *pPBuf)
     dataByte = (1 << ENC28J60_ECON1_TXRTS_BIT);
     enc28j60_lwip_write_spi(SpiConf,  ENC28J60_SPI_BIT_FIELD_SET_OPCODE, ENC28J60_ECON1, dataByte);
 
+    enc28j60_lwip_end_batch(SpiConf);
+
     return ERR_OK;
 }
 
@@ -980,6 +1205,71 @@ void enc28j60_lwip_write_phy_register(SPI_CONFIGURATION *spiConf, UINT8 register
     enc28j60_lwip_write_spi(spiConf,  ENC28J60_SPI_WRITE_CONTROL_REGISTER_OPCODE,ENC28J60_MIWRH, byteData);
 }
 
+/*
+    void enc28j60_lwip_begin_batch(SPI_CONFIGURATION *spiConf)
+    void enc28j60_lwip_end_batch(SPI_CONFIGURATION *spiConf)
+    
+    Register accesses between these calls share one SPI transaction:
+    the peripheral and its pins are set up once, and only the chip
+    select is toggled around each command, as the ENC28J60 requires.
+    Outside a batch every command is a transaction of its own.  Batches
+    nest, the outermost one owns the transaction.
+*/
+void enc28j60_lwip_begin_batch(SPI_CONFIGURATION *spiConf)
+{
+    if(s_ENC28J60_BATCH_DEPTH++ == 0)
+    {
+        CPU_SPI_Xaction_Start(*spiConf);
+
+        /* Xaction_Start selects the device; no clocks were sent so releasing it is harmless */
+        CPU_GPIO_SetPinState(spiConf->DeviceCS, !spiConf->CS_Active);
+    }
+}
+
+void enc28j60_lwip_end_batch(SPI_CONFIGURATION *spiConf)
+{
+    if(--s_ENC28J60_BATCH_DEPTH == 0)
+    {
+        CPU_SPI_Xaction_Stop(*spiConf);
+    }
+}
+
+/*
+    void enc28j60_lwip_spi(SPI_CONFIGURATION *spiConf, ...)
+    
+    Runs one command, with the same arguments as CPU_SPI_nWrite8_nRead8,
+    in the current batch if there is one.
+*/
+static void enc28j60_lwip_spi(SPI_CONFIGURATION *spiConf, 
+                              UINT8 *writeData, 
+                              INT32  writeCount, 
+                              UINT8 *readData, 
+                              INT32  readCount, 
+                              INT32  readStartOffset)
+{
+    SPI_XACTION_8 xaction;
+
+    g_ENC28J60_LWIP_IoStats.SpiCommands++;
+
+    if(s_ENC28J60_BATCH_DEPTH == 0)
+    {
+        CPU_SPI_nWrite8_nRead8(*spiConf, writeData, writeCount, readData, readCount, readStartOffset);
+        return;
+    }
+
+    xaction.Write8          = writeData;
+    xaction.WriteCount      = writeCount;
+    xaction.Read8           = readData;
+    xaction.ReadCount       = readCount;
+    xaction.ReadStartOffset = readStartOffset;
+    xaction.SPI_mod         = spiConf->SPI_mod;
+    xaction.BusyPin.Pin     = GPIO_PIN_NONE;
+
+    CPU_GPIO_SetPinState(spiConf->DeviceCS, spiConf->CS_Active);
+    CPU_SPI_Xaction_nWrite8_nRead8(xaction);
+    CPU_GPIO_SetPinState(spiConf->DeviceCS, !spiConf->CS_Active);
+}
+
 /*
     void enc28j60_lwip_write_spi(PENC28J60_SOFTC sc, 
                             RTP_UINT8 opcode,
@@ -1017,7 +1307,7 @@ void enc28j60_lwip_write_spi(SPI_CONFIGURATION *spiConf,
     commandWithData[0] = opcodeArg;
     commandWithData[1] = byteData;
     
-    CPU_SPI_nWrite8_nRead8 (*spiConf, commandWithData, 2, 0, 0, 0);
+    enc28j60_lwip_spi(spiConf, commandWithData, 2, 0, 0, 0);
 }
 
 /* void enc28j60_lwip_soft_reset(SPI_CONFIGURATION *spiConf)
@@ -1076,7 +1366,9 @@ void enc28j60_lwip_soft_reset(SPI_CONFIGURATION* spiConf)
     /* Combine the command and the data */
     byteData = (ENC28J60_SPI_SYSTEM_COMMAND_SOFT_RESET_OPCODE << 5) | 
                 ENC28J60_SPI_SYSTEM_COMMAND_SOFT_RESET_ARGUMENT;
-    CPU_SPI_nWrite8_nRead8 (*spiConf, (UINT8 *)&byteData, 1, 0, 0, 0);
+    enc28j60_lwip_spi(spiConf, (UINT8 *)&byteData, 1, 0, 0, 0);
+
+    s_ENC28J60_CURRENT_BANK = ENC28J60_BANK_UNKNOWN;
 
     /* Errata : After reset wait for 100 ms */
     for(byteData=0; byteData<100; byteData++)
@@ -1121,7 +1413,7 @@ void enc28j60_lwip_read_spi(SPI_CONFIGURATION *spiConf,
     opcodeArg = ENC28J60_SPI_OPCODE_ARGUMENT(opcode, address);
     
     /* Write the command and read*/
-    CPU_SPI_nWrite8_nRead8 (*spiConf, &opcodeArg, 1, byteData, numBytes+offset, offset+1);
+    enc28j60_lwip_spi(spiConf, &opcodeArg, 1, byteData, numBytes+offset, offset+1);
 }
 
 
@@ -1130,19 +1422,29 @@ void enc28j60_lwip_read_spi(SPI_CONFIGURATION *spiConf,
     void enc28j60_lwip_select_bank(sc, unsigned short bankNumber)
     
     Given the bank number this function selects one of the 
-    four banks.  
+    four banks.  The selected bank is cached, so selecting it again
+    costs nothing; BSEL1:BSEL0 are changed with bit field clear/set so
+    the rest of ECON1 needs no read back.
 */
 
 void enc28j60_lwip_select_bank(SPI_CONFIGURATION *spiConf, UINT8 bankNumber)
 {
     NATIVE_PROFILE_HAL_DRIVERS_ETHERNET();
-    UINT8   byteData = 0;
     
     bankNumber &= 0x3;
+
+    if(bankNumber == s_ENC28J60_CURRENT_BANK)
+    {
+        return;
+    }
         
-    enc28j60_lwip_read_spi(spiConf, ENC28J60_SPI_READ_CONTROL_REGISTER_OPCODE, ENC28J60_ECON1, &byteData, 1, 0);
-    byteData &= 0xFC;
-    byteData |= bankNumber;
-    enc28j60_lwip_write_spi( spiConf, ENC28J60_SPI_WRITE_CONTROL_REGISTER_OPCODE, ENC28J60_ECON1, byteData);
+    enc28j60_lwip_write_spi( spiConf, ENC28J60_SPI_BIT_FIELD_CLEAR_OPCODE, ENC28J60_ECON1, (UINT8)0x03);
+
+    if(bankNumber)
+    {
+        enc28j60_lwip_write_spi( spiConf, ENC28J60_SPI_BIT_FIELD_SET_OPCODE, ENC28J60_ECON1, bankNumber);
+    }
+
+    s_ENC28J60_CURRENT_BANK = bankNumber;
 }
 
@@ -71,9 +71,13 @@ BOOL USART_Initialize( int ComPortNum, int BaudRate, int Parity, int DataBits, i
 BOOL USART_Uninitialize( int ComPortNum );
 int  USART_Write( int ComPortNum, const char* Data, size_t size );
 int  USART_Read( int ComPortNum, char* Data, size_t size );
+int  USART_ReadFrame( int ComPortNum, char* Data, size_t size, int Delimiter, size_t WakeCount, BOOL& fComplete, UINT64& LastRxTicks );
 BOOL USART_Flush( int ComPortNum );
 BOOL USART_AddCharToRxBuffer( int ComPortNum, char c );
+BOOL USART_AddBlockToRxBuffer( int ComPortNum, const UINT8* Data, size_t size );
 BOOL USART_RemoveCharFromTxBuffer( int ComPortNum, char& c );
+size_t USART_GetTxBlock( int ComPortNum, const UINT8*& Data );
+void USART_TxBlockSent( int ComPortNum, const UINT8* Data, size_t size );
 INT8 USART_PowerSave( int ComPortNum, INT8 Enable );
 void USART_PrepareForClockStop();
 void USART_ClockStopFinished();
@@ -20,6 +20,7 @@
 #else
 #include "..\stm32f10x.h"
 #endif
+#include "STM32_AD_functions.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -32,6 +33,321 @@
 #define STM32_AD_SAMPLE_TIME 3    // sample time = 28.5 cycles
 #endif
 
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+// continuous sampling: TIM8 TRGO starts a regular group scan, DMA2 stream 4 channel 0 stores it
+// (stream 0 belongs to SPI1)
+#define STM32_AD_DMA_STREAM    DMA2_Stream4
+#define STM32_AD_DMA_FLAGS     0x3D // FEIF | DMEIF | TEIF | HTIF | TCIF (stream 4 position)
+#define STM32_AD_TRIGGER_TIM8  14   // EXTSEL: TIM8 TRGO
+
+#if SYSTEM_APB2_CLOCK_HZ == SYSTEM_CYCLE_CLOCK_HZ
+#define TIM8CLK_HZ SYSTEM_APB2_CLOCK_HZ
+#else
+#define TIM8CLK_HZ (SYSTEM_APB2_CLOCK_HZ * 2)
+#endif
+
+// a scan converts each channel in turn: 28 cycles sample time + 12 cycles for 12 bits, at ADCCLK = PCLK2 / 2
+#define STM32_AD_CLOCK_HZ          (SYSTEM_APB2_CLOCK_HZ / 2)
+#define STM32_AD_CONVERSION_CYCLES 40
+
+struct STM32_AD_SAMPLING
+{
+    UINT16*                    buffer;     // NULL if not sampling
+    UINT32                     bufferSize;
+    UINT8                      channels[STM32_AD_CHANNELS];
+    UINT32                     numChannels;
+    STM32_AD_SAMPLING_CALLBACK callback;
+    void*                      context;
+    UINT32                     overruns;
+};
+
+static STM32_AD_SAMPLING g_STM32_AD_Sampling;
+
+// (re)starts the DMA at the beginning of the buffer, in step with the scan sequence
+static void STM32_AD_DmaStart()
+{
+    STM32_AD_DMA_STREAM->CR = 0;
+    while (STM32_AD_DMA_STREAM->CR & DMA_SxCR_EN);
+    DMA2->HIFCR = STM32_AD_DMA_FLAGS;
+
+    // peripheral to memory, half words
+    STM32_AD_DMA_STREAM->PAR  = (UINT32)&ADC1->DR;
+    STM32_AD_DMA_STREAM->M0AR = (UINT32)g_STM32_AD_Sampling.buffer;
+    STM32_AD_DMA_STREAM->NDTR = g_STM32_AD_Sampling.bufferSize;
+    STM32_AD_DMA_STREAM->FCR  = 0; // direct mode
+    STM32_AD_DMA_STREAM->CR   = DMA_SxCR_PL_1 | DMA_SxCR_PSIZE_0 | DMA_SxCR_MSIZE_0 // channel 0, high priority
+                              | DMA_SxCR_MINC | DMA_SxCR_CIRC | DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    STM32_AD_DMA_STREAM->CR  |= DMA_SxCR_EN;
+
+    // the DMA bit has to be set again after an overrun
+    ADC1->CR2 &= ~ADC_CR2_DMA;
+    ADC1->SR = ~ADC_SR_OVR;
+    ADC1->CR2 |= ADC_CR2_DMA;
+}
+
+static void STM32_AD_DmaInterrupt( void* param )
+{
+    INTERRUPT_START
+
+    UINT32 isr = DMA2->HISR;
+    DMA2->HIFCR = isr & STM32_AD_DMA_FLAGS;
+
+    UINT32 half = g_STM32_AD_Sampling.bufferSize >> 1;
+
+    if (isr & DMA_HISR_HTIF4) {
+        g_STM32_AD_Sampling.callback(g_STM32_AD_Sampling.context, g_STM32_AD_Sampling.buffer, half);
+    }
+    if (isr & DMA_HISR_TCIF4) {
+        g_STM32_AD_Sampling.callback(g_STM32_AD_Sampling.context, g_STM32_AD_Sampling.buffer + half, half);
+    }
+    if (isr & DMA_HISR_TEIF4) { // the stream stops itself on errors
+        g_STM32_AD_Sampling.overruns++;
+        STM32_AD_DmaStart();
+    }
+
+    INTERRUPT_END
+}
+
+static void STM32_AD_Interrupt( void* param )
+{
+    INTERRUPT_START
+
+    if (ADC1->SR & ADC_SR_OVR) { // a conversion was not fetched in time, the DMA requests have stopped
+        g_STM32_AD_Sampling.overruns++;
+        STM32_AD_DmaStart();
+    }
+
+    INTERRUPT_END
+}
+
+BOOL STM32_AD_StartSampling( const ANALOG_CHANNEL* channels, UINT32 numChannels, UINT32 sampleRateHz,
+                             UINT16* buffer, UINT32 bufferSize, STM32_AD_SAMPLING_CALLBACK callback, void* context )
+{
+    if (channels == NULL || numChannels == 0 || numChannels > STM32_AD_CHANNELS) return FALSE;
+    if (buffer == NULL || callback == NULL || sampleRateHz == 0) return FALSE;
+    // a trigger arriving before the previous scan is done overruns the ADC on every scan
+    if ((UINT64)sampleRateHz * numChannels * STM32_AD_CONVERSION_CYCLES > STM32_AD_CLOCK_HZ) return FALSE;
+    if (bufferSize == 0 || bufferSize > 0xFFFF || bufferSize % (2 * numChannels)) return FALSE;
+    if (((UINT32)buffer & 0xF0000000) == 0x10000000) return FALSE; // CCM data RAM is not reachable by DMA
+
+    for (UINT32 i = 0; i < numChannels; i++) {
+        if ((UINT32)channels[i] >= STM32_AD_CHANNELS) return FALSE;
+    }
+
+    STM32_AD_StopSampling();
+
+    for (UINT32 i = 0; i < numChannels; i++) {
+        if (!AD_Initialize(channels[i], 12)) return FALSE; // clock, sample times, pins
+        g_STM32_AD_Sampling.channels[i] = (UINT8)channels[i];
+    }
+
+    GLOBAL_LOCK(irq);
+
+    g_STM32_AD_Sampling.buffer      = buffer;
+    g_STM32_AD_Sampling.bufferSize  = bufferSize;
+    g_STM32_AD_Sampling.numChannels = numChannels;
+    g_STM32_AD_Sampling.callback    = callback;
+    g_STM32_AD_Sampling.context     = context;
+    g_STM32_AD_Sampling.overruns    = 0;
+
+    // regular group: the channels in order, one scan per trigger
+    UINT32 sqr3 = 0;
+    for (UINT32 i = 0; i < numChannels; i++) {
+        sqr3 |= (STM32_AD_FIRST_CHANNEL + channels[i]) << (5 * i);
+    }
+    ADC1->SQR1 = (numChannels - 1) << 20;
+    ADC1->SQR3 = sqr3;
+    ADC1->CR1  = ADC_CR1_SCAN | ADC_CR1_OVRIE;
+    ADC1->CR2  = ADC_CR2_ADON | ADC_CR2_DDS | ADC_CR2_EXTEN_0 // rising edge
+               | (STM32_AD_TRIGGER_TIM8 * ADC_CR2_EXTSEL_0);
+
+    RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+    STM32_AD_DmaStart();
+
+    CPU_INTC_ActivateInterrupt(DMA2_Stream4_IRQn, STM32_AD_DmaInterrupt, 0);
+    CPU_INTC_ActivateInterrupt(ADC_IRQn, STM32_AD_Interrupt, 0);
+
+    // trigger timer: update event -> TRGO
+    RCC->APB2ENR |= RCC_APB2ENR_TIM8EN;
+    UINT32 ticks = (TIM8CLK_HZ + (sampleRateHz >> 1)) / sampleRateHz; // rounded
+    UINT32 prescaler = (ticks - 1) >> 16;
+    TIM8->CR1 = 0;
+    TIM8->CR2 = TIM_CR2_MMS_1; // TRGO on update
+    TIM8->PSC = prescaler;
+    TIM8->ARR = ticks / (prescaler + 1) - 1;
+    TIM8->EGR = TIM_EGR_UG; // load prescaler
+    TIM8->SR  = 0;
+    TIM8->CR1 = TIM_CR1_CEN;
+
+    return TRUE;
+}
+
+void STM32_AD_StopSampling()
+{
+    GLOBAL_LOCK(irq);
+
+    if (g_STM32_AD_Sampling.buffer == NULL) return;
+
+    TIM8->CR1 = 0;
+    RCC->APB2ENR &= ~RCC_APB2ENR_TIM8EN;
+
+    CPU_INTC_DeactivateInterrupt(ADC_IRQn);
+    CPU_INTC_DeactivateInterrupt(DMA2_Stream4_IRQn);
+
+    STM32_AD_DMA_STREAM->CR = 0;
+    while (STM32_AD_DMA_STREAM->CR & DMA_SxCR_EN);
+    DMA2->HIFCR = STM32_AD_DMA_FLAGS;
+
+    // back to single software triggered conversions for AD_Read
+    ADC1->CR2  = ADC_CR2_ADON;
+    ADC1->CR1  = 0;
+    ADC1->SQR1 = 0;
+    ADC1->SR   = 0;
+
+    g_STM32_AD_Sampling.buffer = NULL;
+}
+
+BOOL STM32_AD_IsSampling()
+{
+    return g_STM32_AD_Sampling.buffer != NULL;
+}
+
+UINT32 STM32_AD_SamplingOverruns()
+{
+    return g_STM32_AD_Sampling.overruns;
+}
+#endif
+
+//--//
+
+BOOL STM32_AD_FilterInit( STM32_AD_FILTER& filter, UINT32 type, UINT32 decimation, UINT32 param )
+{
+    memset(&filter, 0, sizeof(filter));
+
+    if (decimation == 0) return FALSE;
+
+    switch (type) {
+    case STM32_AD_FILTER_BOXCAR:
+        if (decimation > 0x10000) return FALSE; // keeps the sum of 12 bit samples in 28 bits
+        break;
+    case STM32_AD_FILTER_CIC:
+        if (param == 0 || param > STM32_AD_FILTER_CIC_MAX_ORDER) return FALSE;
+        if (decimation & (decimation - 1)) return FALSE;
+        while ((1u << filter.shift) < decimation) filter.shift++;
+        filter.shift *= param; // gain = decimation ^ order
+        if (filter.shift > 20) return FALSE; // 12 bit samples must not outgrow 32 bits
+        break;
+    case STM32_AD_FILTER_IIR:
+        if (param == 0 || param > 15) return FALSE;
+        break;
+    default:
+        return FALSE;
+    }
+
+    filter.type = type;
+    filter.decimation = decimation;
+    filter.param = param;
+    return TRUE;
+}
+
+// sum of n consecutive samples
+static UINT32 STM32_AD_Sum( const UINT16* p, UINT32 n, UINT32 acc )
+{
+#if defined(PLATFORM_ARM_STM32F4_ANY)
+    if (n && ((UINT32)p & 2)) { // align to a word
+        acc += *p++;
+        n--;
+    }
+    const UINT32* w = (const UINT32*)p;
+    for (; n >= 2; n -= 2) {
+        acc = __SMLAD(*w++, 0x00010001, acc); // both halves at once; ADC samples are positive as INT16
+    }
+    p = (const UINT16*)w;
+#endif
+    while (n--) acc += *p++;
+    return acc;
+}
+
+UINT32 STM32_AD_FilterRun( STM32_AD_FILTER& filter, const UINT16* samples, UINT32 count, UINT32 stride, INT32* output )
+{
+    UINT32 produced = 0;
+
+    switch (filter.type) {
+    case STM32_AD_FILTER_BOXCAR:
+        while (count) {
+            UINT32 n = filter.decimation - filter.phase;
+            if (n > count) n = count;
+            if (stride == 1) {
+                filter.acc = STM32_AD_Sum(samples, n, filter.acc);
+            } else {
+                for (UINT32 i = 0; i < n; i++) filter.acc += samples[i * stride];
+            }
+            samples += n * stride;
+            count -= n;
+            filter.phase += n;
+            if (filter.phase == filter.decimation) {
+                output[produced++] = (INT32)(((UINT64)filter.acc << STM32_AD_FILTER_FRACTION_BITS) / filter.decimation);
+                filter.acc = 0;
+                filter.phase = 0;
+            }
+        }
+        break;
+
+    case STM32_AD_FILTER_CIC:
+        for (; count; count--, samples += stride) {
+            UINT32 x = *samples;
+            for (UINT32 k = 0; k < filter.param; k++) {
+                x = filter.integrator[k] += x;
+            }
+            if (++filter.phase == filter.decimation) {
+                for (UINT32 k = 0; k < filter.param; k++) {
+                    UINT32 prev = filter.comb[k];
+                    filter.comb[k] = x;
+                    x -= prev;
+                }
+                if (filter.shift >= STM32_AD_FILTER_FRACTION_BITS) {
+                    output[produced++] = (INT32)(x >> (filter.shift - STM32_AD_FILTER_FRACTION_BITS));
+                } else {
+                    output[produced++] = (INT32)(x << (STM32_AD_FILTER_FRACTION_BITS - filter.shift));
+                }
+                filter.phase = 0;
+            }
+        }
+        break;
+
+    case STM32_AD_FILTER_IIR:
+        for (; count; count--, samples += stride) {
+            INT32 x = (INT32)*samples << STM32_AD_FILTER_FRACTION_BITS;
+            if (filter.primed) {
+                filter.acc += (x - filter.acc) >> filter.param;
+            } else { // start from the first sample rather than ramping up from 0
+                filter.acc = x;
+                filter.primed = TRUE;
+            }
+            if (++filter.phase == filter.decimation) {
+                output[produced++] = filter.acc;
+                filter.phase = 0;
+            }
+        }
+        break;
+    }
+
+    return produced;
+}
+
+BOOL STM32_AD_ReadFiltered( ANALOG_CHANNEL channel, STM32_AD_FILTER& filter, INT32& value )
+{
+    if (filter.decimation == 0) return FALSE; // not initialized
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+    if (STM32_AD_IsSampling()) return FALSE; // AD_Read would return the same latched sample
+#endif
+
+    for (;;) {
+        UINT16 sample = (UINT16)AD_Read(channel);
+        if (STM32_AD_FilterRun(filter, &sample, 1, 1, &value)) return TRUE;
+    }
+}
+
 //--//
 
 BOOL AD_Initialize( ANALOG_CHANNEL channel, INT32 precisionInBits )
@@ -58,6 +374,19 @@ BOOL AD_Initialize( ANALOG_CHANNEL channel, INT32 precisionInBits )
 
 INT32 AD_Read( ANALOG_CHANNEL channel )
 {
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+    if (g_STM32_AD_Sampling.buffer) { // the ADC is busy sampling, return the newest sample of the channel, -1 if not scanned
+        GLOBAL_LOCK(irq);
+        UINT32 n = g_STM32_AD_Sampling.numChannels;
+        UINT32 size = g_STM32_AD_Sampling.bufferSize;
+        UINT32 next = size - STM32_AD_DMA_STREAM->NDTR; // next sample to be written
+        UINT32 scan = (next + size - n) / n * n % size; // start of the last complete scan
+        for (UINT32 i = 0; i < n; i++) {
+            if (g_STM32_AD_Sampling.channels[i] == (UINT32)channel) return g_STM32_AD_Sampling.buffer[scan + i];
+        }
+        return -1;
+    }
+#endif
     int x = ADC1->DR; // clear EOC flag
     ADC1->SQR3 = STM32_AD_FIRST_CHANNEL + channel; // select channel
 #if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
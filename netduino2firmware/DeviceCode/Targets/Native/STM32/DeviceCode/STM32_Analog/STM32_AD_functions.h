@@ -0,0 +1,53 @@
+#ifndef STM32_AD_FUNCTIONS_H
+#define STM32_AD_FUNCTIONS_H
+
+// Continuous sampling: every sampleRateHz tick of TIM8 converts the given channels once, in order,
+// and DMA stores the results interleaved into buffer. The buffer is used as two halves; whenever
+// one is full the callback gets it from the DMA interrupt while the other one is being filled,
+// so it must be done with the samples (or hand them on) within half a buffer's time.
+// bufferSize counts samples and must be a multiple of 2 * numChannels. sampleRateHz * numChannels
+// must not exceed the ADC conversion rate of PCLK2 / 80 (750 kHz with a 60 MHz PCLK2).
+// While sampling runs, AD_Read returns the newest sample of a scanned channel and -1 for any other.
+typedef void (*STM32_AD_SAMPLING_CALLBACK)( void* context, UINT16* samples, UINT32 count );
+
+BOOL   STM32_AD_StartSampling( const ANALOG_CHANNEL* channels, UINT32 numChannels, UINT32 sampleRateHz,
+                               UINT16* buffer, UINT32 bufferSize, STM32_AD_SAMPLING_CALLBACK callback, void* context );
+void   STM32_AD_StopSampling();
+BOOL   STM32_AD_IsSampling();
+UINT32 STM32_AD_SamplingOverruns(); // scans lost because the DMA fell behind, since the start
+
+// Filters turn raw samples into fewer, steadier values, one output per `decimation` inputs:
+//  - boxcar: the mean of each block of `decimation` samples (at most 65536)
+//  - CIC:    `param` (1..3) cascaded integrator-comb stages; `decimation` must be a power of two
+//            with param * log2(decimation) <= 20
+//  - IIR:    single pole low pass y += (x - y) / 2^param (param 1..15), sampled every `decimation` inputs
+// Outputs are ADC counts with STM32_AD_FILTER_FRACTION_BITS fraction bits, which keeps the
+// resolution gained by oversampling.
+#define STM32_AD_FILTER_BOXCAR         0
+#define STM32_AD_FILTER_CIC            1
+#define STM32_AD_FILTER_IIR            2
+#define STM32_AD_FILTER_FRACTION_BITS  8
+#define STM32_AD_FILTER_CIC_MAX_ORDER  3
+
+struct STM32_AD_FILTER
+{
+    UINT32 type;
+    UINT32 decimation;
+    UINT32 param;
+    UINT32 shift;  // CIC: log2 of the gain
+    UINT32 phase;  // inputs since the last output
+    BOOL   primed; // IIR: state holds a sample
+    INT32  acc;    // boxcar sum, IIR state
+    UINT32 integrator[STM32_AD_FILTER_CIC_MAX_ORDER]; // CIC, modulo 2^32
+    UINT32 comb[STM32_AD_FILTER_CIC_MAX_ORDER];
+};
+
+BOOL   STM32_AD_FilterInit( STM32_AD_FILTER& filter, UINT32 type, UINT32 decimation, UINT32 param );
+// Feeds count samples taken every `stride` elements (e.g. one channel of an interleaved sampling
+// buffer) and returns the number of outputs written; output needs room for count / decimation + 1.
+UINT32 STM32_AD_FilterRun( STM32_AD_FILTER& filter, const UINT16* samples, UINT32 count, UINT32 stride, INT32* output );
+// Converts channel with AD_Read until the filter yields a value. Fails while continuous sampling
+// runs, since AD_Read then repeats the last scan; filter the sampling buffers with FilterRun instead.
+BOOL   STM32_AD_ReadFiltered( ANALOG_CHANNEL channel, STM32_AD_FILTER& filter, INT32& value );
+
+#endif
@@ -60,6 +60,238 @@ static SPI_TypeDef* g_STM32_Spi[] = {SPI2, SPI1, SPI3}; // IO addresses
 static SPI_TypeDef* g_STM32_Spi[] = {SPI1, SPI2, SPI3}; // IO addresses
 #endif
 
+// DMA
+// Transfers of at least STM32_SPI_DMA_THRESHOLD frames are moved by the DMA controller,
+// shorter ones are cheaper to poll than to set up two streams for. Either way the transaction
+// is synchronous: the caller waits for the stream flags instead of every frame's RXNE.
+#ifndef STM32_SPI_DMA_THRESHOLD
+#define STM32_SPI_DMA_THRESHOLD 16
+#endif
+
+#define STM32_SPI_DMA_FLAGS  0x3D // FEIF | DMEIF | TEIF | HTIF | TCIF (stream 0 position)
+#define STM32_SPI_DMA_ERRORS (DMA_LISR_TEIF0 | DMA_LISR_DMEIF0)
+
+struct STM32_SPI_DMA_CONFIG
+{
+    DMA_TypeDef*        dma;
+    DMA_Stream_TypeDef* rxStream;
+    DMA_Stream_TypeDef* txStream;
+    UINT8               rxStreamNum;
+    UINT8               txStreamNum;
+    UINT8               channel;
+};
+
+struct STM32_SPI_DMA_STATE
+{
+    BOOL busy;
+    BOOL error;
+};
+
+// streams are chosen to stay clear of the USART and ADC streams:
+// SPI1: DMA2 ch3 rx S0 / tx S3, SPI2: DMA1 ch0 rx S3 / tx S4, SPI3: DMA1 ch0 rx S0 / tx S7
+#if defined(PLATFORM_ARM_Netduino2) || defined(PLATFORM_ARM_NetduinoPlus2) || defined(PLATFORM_ARM_NetduinoShieldBase)
+static const STM32_SPI_DMA_CONFIG g_STM32_SPI_DmaConfig[] = {
+    {DMA1, DMA1_Stream3, DMA1_Stream4, 3, 4, 0},  // SPI2
+    {DMA2, DMA2_Stream0, DMA2_Stream3, 0, 3, 3},  // SPI1
+    {DMA1, DMA1_Stream0, DMA1_Stream7, 0, 7, 0}}; // SPI3
+#else
+static const STM32_SPI_DMA_CONFIG g_STM32_SPI_DmaConfig[] = {
+    {DMA2, DMA2_Stream0, DMA2_Stream3, 0, 3, 3},  // SPI1
+    {DMA1, DMA1_Stream3, DMA1_Stream4, 3, 4, 0},  // SPI2
+    {DMA1, DMA1_Stream0, DMA1_Stream7, 0, 7, 0}}; // SPI3
+#endif
+
+static STM32_SPI_DMA_STATE g_STM32_SPI_DmaState[3];
+
+// DMA cannot reach CCM RAM, where some scatterfiles put RW/ZI data
+#pragma arm section zidata = "SectionForDmaBuffers"
+static UINT16 g_STM32_SPI_DmaDummy; // sink for discarded input and source for fill output
+#pragma arm section zidata
+
+
+static inline UINT32 STM32_SPI_DmaFlagShift( UINT32 stream )
+{
+    static const UINT8 shift[] = {0, 6, 16, 22};
+    return shift[stream & 3];
+}
+
+static inline UINT32 STM32_SPI_DmaStatus( const STM32_SPI_DMA_CONFIG& cfg, UINT32 stream )
+{
+    UINT32 isr = stream < 4 ? cfg.dma->LISR : cfg.dma->HISR;
+    return (isr >> STM32_SPI_DmaFlagShift(stream)) & STM32_SPI_DMA_FLAGS;
+}
+
+static inline void STM32_SPI_DmaClear( const STM32_SPI_DMA_CONFIG& cfg, UINT32 stream )
+{
+    UINT32 mask = STM32_SPI_DMA_FLAGS << STM32_SPI_DmaFlagShift(stream);
+    if (stream < 4) cfg.dma->LIFCR = mask;
+    else            cfg.dma->HIFCR = mask;
+}
+
+static inline BOOL STM32_SPI_DmaCapable( const void* buf )
+{
+    return ((UINT32)buf & 0xF0000000) != 0x10000000; // CCM data RAM is not reachable by DMA
+}
+
+// stops both streams once the transfer is done
+static void STM32_SPI_DmaFinish( UINT32 spi_mod )
+{
+    STM32_SPI_DMA_STATE& state = g_STM32_SPI_DmaState[spi_mod];
+    if (!state.busy) return;
+
+    const STM32_SPI_DMA_CONFIG& cfg = g_STM32_SPI_DmaConfig[spi_mod];
+    UINT32 status = STM32_SPI_DmaStatus(cfg, cfg.rxStreamNum) | STM32_SPI_DmaStatus(cfg, cfg.txStreamNum);
+
+    cfg.rxStream->CR = 0;
+    cfg.txStream->CR = 0;
+    STM32_SPI_DmaClear(cfg, cfg.rxStreamNum);
+    STM32_SPI_DmaClear(cfg, cfg.txStreamNum);
+    g_STM32_Spi[spi_mod]->CR2 = 0;
+
+    state.error = (status & STM32_SPI_DMA_ERRORS) != 0;
+    state.busy = FALSE;
+}
+
+// twice the time the frames take on the wire at the configured prescaler, plus a millisecond
+static UINT32 STM32_SPI_DmaTimeout( UINT32 spi_mod, INT32 count, BOOL is16 )
+{
+    SPI_TypeDef* spi = g_STM32_Spi[spi_mod];
+    UINT32 clock = (spi == SPI1 ? SYSTEM_APB2_CLOCK_HZ : SYSTEM_APB1_CLOCK_HZ) / 1000;
+    clock >>= ((spi->CR1 & SPI_CR1_BR) >> 3) + 1; // kHz
+    UINT32 bits = count * (is16 ? 16 : 8);
+    return bits * 2000 / clock + 1000; // uSec
+}
+
+static BOOL STM32_SPI_DmaStart( UINT32 spi_mod, void* out, BOOL outInc, void* in, BOOL inInc, INT32 count, BOOL is16 )
+{
+    const STM32_SPI_DMA_CONFIG& cfg = g_STM32_SPI_DmaConfig[spi_mod];
+    STM32_SPI_DMA_STATE& state = g_STM32_SPI_DmaState[spi_mod];
+    SPI_TypeDef* spi = g_STM32_Spi[spi_mod];
+
+    if (state.busy || count > 0xFFFF) return FALSE;
+
+    UINT32 ctrl = (cfg.channel * DMA_SxCR_CHSEL_0) | DMA_SxCR_PL_1; // high priority
+    if (is16) ctrl |= DMA_SxCR_PSIZE_0 | DMA_SxCR_MSIZE_0;
+
+    STM32_SPI_DmaClear(cfg, cfg.rxStreamNum);
+    STM32_SPI_DmaClear(cfg, cfg.txStreamNum);
+
+    // peripheral to memory
+    cfg.rxStream->PAR  = (UINT32)&spi->DR;
+    cfg.rxStream->M0AR = (UINT32)in;
+    cfg.rxStream->NDTR = count;
+    cfg.rxStream->FCR  = 0; // direct mode
+    cfg.rxStream->CR   = ctrl | (inInc ? DMA_SxCR_MINC : 0);
+
+    // memory to peripheral
+    cfg.txStream->PAR  = (UINT32)&spi->DR;
+    cfg.txStream->M0AR = (UINT32)out;
+    cfg.txStream->NDTR = count;
+    cfg.txStream->FCR  = 0; // direct mode
+    cfg.txStream->CR   = ctrl | DMA_SxCR_DIR_0 | (outInc ? DMA_SxCR_MINC : 0);
+
+    state.error = FALSE;
+    state.busy = TRUE;
+
+    cfg.rxStream->CR |= DMA_SxCR_EN;
+    cfg.txStream->CR |= DMA_SxCR_EN;
+    spi->CR2 = SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN; // starts the transfer
+
+    return TRUE;
+}
+
+// Completes a running transfer by polling; works with interrupts disabled. The transfer is done
+// when the rx stream completes, and fails on an error from either stream or on the timeout.
+static BOOL STM32_SPI_DmaWait( UINT32 spi_mod, INT32 count, BOOL is16 )
+{
+    const STM32_SPI_DMA_CONFIG& cfg = g_STM32_SPI_DmaConfig[spi_mod];
+    STM32_SPI_DMA_STATE& state = g_STM32_SPI_DmaState[spi_mod];
+    UINT64 start = HAL_Time_CurrentTicks();
+    UINT64 timeout = CPU_MicrosecondsToTicks((UINT64)STM32_SPI_DmaTimeout(spi_mod, count, is16));
+
+    while (state.busy) {
+        UINT32 rx = STM32_SPI_DmaStatus(cfg, cfg.rxStreamNum);
+        UINT32 tx = STM32_SPI_DmaStatus(cfg, cfg.txStreamNum);
+        if ((rx & (DMA_LISR_TCIF0 | STM32_SPI_DMA_ERRORS)) || (tx & STM32_SPI_DMA_ERRORS)) {
+            STM32_SPI_DmaFinish(spi_mod);
+        } else if (HAL_Time_CurrentTicks() - start > timeout) {
+            STM32_SPI_DmaFinish(spi_mod);
+            state.error = TRUE;
+        }
+    }
+    return !state.error;
+}
+
+static void STM32_SPI_Polled8( SPI_TypeDef* spi, UINT8* out, INT32 outInc, UINT8* in, INT32 inInc, INT32 count )
+{
+    while (count--) {
+        spi->DR = *out; // start output
+        out += outInc;
+        while (!(spi->SR & SPI_SR_RXNE)); // wait for Rx buffer full
+        *in = (UINT8)spi->DR; // save input data
+        in += inInc;
+    }
+}
+
+static void STM32_SPI_Polled16( SPI_TypeDef* spi, UINT16* out, INT32 outInc, UINT16* in, INT32 inInc, INT32 count )
+{
+    while (count--) {
+        spi->DR = *out; // start output
+        out += outInc;
+        while (!(spi->SR & SPI_SR_RXNE)); // wait for Rx buffer full
+        *in = spi->DR; // save input data
+        in += inInc;
+    }
+}
+
+// Runs a transaction as up to three segments of constant buffer stepping: the output buffer
+// is repeated by its last frame once exhausted and input is discarded up to ReadStartOffset.
+// Long segments use DMA, short ones are polled.
+static BOOL STM32_SPI_Xaction( UINT32 spi_mod, UINT8* outBuf, INT32 outLen, UINT8* inBuf, INT32 readCount, INT32 readStart, BOOL is16 )
+{
+    if (spi_mod >= 3) return FALSE;
+
+    SPI_TypeDef* spi = g_STM32_Spi[spi_mod];
+    UINT32 frame = is16 ? 2 : 1;
+    INT32 num, skip;
+
+    if (readCount) { // write & read
+        num = readCount + readStart;
+        skip = readStart;
+    } else { // write only
+        num = outLen;
+        skip = num; // discard all input
+    }
+
+    UINT8* fill = outLen > 0 ? outBuf + (outLen - 1) * frame : (UINT8*)&g_STM32_SPI_DmaDummy;
+
+    INT32 i = 0;
+    while (i < num) {
+        // end of the segment at the next boundary
+        INT32 end = num;
+        if (i < outLen && outLen < end) end = outLen;
+        if (i < skip && skip < end) end = skip;
+
+        INT32 count = end - i;
+        BOOL outInc = i < outLen;
+        BOOL inInc = i >= skip;
+        UINT8* out = outInc ? outBuf + i * frame : fill;
+        UINT8* in = inInc ? inBuf + (i - skip) * frame : (UINT8*)&g_STM32_SPI_DmaDummy;
+
+        if (count >= STM32_SPI_DMA_THRESHOLD && STM32_SPI_DmaCapable(out) && STM32_SPI_DmaCapable(in)
+            && STM32_SPI_DmaStart(spi_mod, out, outInc, in, inInc, count, is16)) {
+            if (!STM32_SPI_DmaWait(spi_mod, count, is16)) return FALSE;
+        } else if (is16) {
+            STM32_SPI_Polled16(spi, (UINT16*)out, outInc, (UINT16*)in, inInc, count);
+        } else {
+            STM32_SPI_Polled8(spi, out, outInc, in, inInc, count);
+        }
+        i = end;
+    }
+
+    return TRUE;
+}
+
 
 BOOL CPU_SPI_Initialize()
 {
@@ -68,6 +300,7 @@ BOOL CPU_SPI_Initialize()
     STM32_RCC_APB2PeripheralClockEnable(RCC_APB2ENR_SPI1EN);
     STM32_RCC_APB1PeripheralClockEnable(RCC_APB1ENR_SPI2EN);
     STM32_RCC_APB1PeripheralClockEnable(RCC_APB1ENR_SPI3EN);
+    STM32_RCC_AHB1PeripheralClockEnable(RCC_AHB1ENR_DMA1EN | RCC_AHB1ENR_DMA2EN);
 
     CPU_GPIO_EnableInputPin(SPI1_SCLK_Pin, FALSE, NULL, GPIO_INT_NONE, RESISTOR_PULLDOWN);
 	CPU_GPIO_EnableInputPin(SPI1_MOSI_Pin, FALSE, NULL, GPIO_INT_NONE, RESISTOR_PULLDOWN);
@@ -225,74 +458,16 @@ BOOL CPU_SPI_Xaction_nWrite16_nRead16( SPI_XACTION_16& Transaction )
 {
     NATIVE_PROFILE_HAL_PROCESSOR_SPI();
 
-    SPI_TypeDef* spi = g_STM32_Spi[Transaction.SPI_mod];
-
-    UINT16* outBuf = Transaction.Write16;
-    UINT16* inBuf  = Transaction.Read16;
-    INT32 outLen = Transaction.WriteCount;
-    INT32 num, ii, i = 0;
-
-    if (Transaction.ReadCount) { // write & read
-        num = Transaction.ReadCount + Transaction.ReadStartOffset;
-        ii = -Transaction.ReadStartOffset;
-    } else { // write only
-        num = outLen;
-        ii = 0x80000000; // disable write to inBuf
-    }
-
-    UINT16 out = outBuf[0];
-    UINT16 in;
-    spi->DR = out; // write first word
-    while (++i < num) {
-        if (i < outLen) out = outBuf[i]; // get new output data
-        while (!(spi->SR & SPI_SR_RXNE)); // wait for Rx buffer full
-        in = spi->DR; // read input
-        spi->DR = out; // start output
-        if (ii >= 0) inBuf[ii] = in; // save input data
-        ii++;
-    }
-    while (!(spi->SR & SPI_SR_RXNE)); // wait for Rx buffer full
-    in = spi->DR; // read last input
-    if (ii >= 0) inBuf[ii] = in; // save last input
-
-    return TRUE;
+    return STM32_SPI_Xaction( Transaction.SPI_mod, (UINT8*)Transaction.Write16, Transaction.WriteCount,
+                              (UINT8*)Transaction.Read16, Transaction.ReadCount, Transaction.ReadStartOffset, TRUE );
 }
 
 BOOL CPU_SPI_Xaction_nWrite8_nRead8( SPI_XACTION_8& Transaction )
 {
     NATIVE_PROFILE_HAL_PROCESSOR_SPI();
 
-    SPI_TypeDef* spi = g_STM32_Spi[Transaction.SPI_mod];
-
-    UINT8* outBuf = Transaction.Write8;
-    UINT8* inBuf  = Transaction.Read8;
-    INT32 outLen = Transaction.WriteCount;
-    INT32 num, ii, i = 0;
-
-    if (Transaction.ReadCount) { // write & read
-        num = Transaction.ReadCount + Transaction.ReadStartOffset;
-        ii = -Transaction.ReadStartOffset;
-    } else { // write only
-        num = outLen;
-        ii = 0x80000000; // disable write to inBuf
-    }
-
-    UINT8 out = outBuf[0];
-    UINT16 in;
-    spi->DR = out; // write first word
-    while (++i < num) {
-        if (i < outLen) out = outBuf[i]; // get new output data
-        while (!(spi->SR & SPI_SR_RXNE)); // wait for Rx buffer full
-        in = spi->DR; // read input
-        spi->DR = out; // start output
-        if (ii >= 0) inBuf[ii] = (UINT8)in; // save input data
-        ii++;
-    }
-    while (!(spi->SR & SPI_SR_RXNE)); // wait for Rx buffer full
-    in = spi->DR; // read last input
-    if (ii >= 0) inBuf[ii] = (UINT8)in; // save last input
-
-    return TRUE;
+    return STM32_SPI_Xaction( Transaction.SPI_mod, Transaction.Write8, Transaction.WriteCount,
+                              Transaction.Read8, Transaction.ReadCount, Transaction.ReadStartOffset, FALSE );
 }
 
 UINT32 CPU_SPI_PortsCount()
@@ -42,14 +42,308 @@ static const UINT32 g_STM32_UART_Irq[] = {USART1_IRQn, USART2_IRQn, USART3_IRQn,
 static USART_TypeDef* g_STM32_Uart[] = {USART1, USART2, USART3}; // IO addresses
 #endif
 
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+// DMA
+// Ports with a free DMA stream receive into a circular buffer of STM32_USART_RX_DMA_SIZE bytes.
+// The buffer is handed to the PAL in blocks on the half transfer, transfer complete and IDLE line
+// interrupts, so a burst costs a few interrupts instead of one per character. At 921600 baud
+// (92 bytes/ms) a 512 byte buffer leaves the drain 2.7 ms past each half transfer interrupt before
+// the stream laps it; a lap is reported as USART_EVENT_ERROR_RXOVER.
+// Ports with a free transmit stream send the TX queue in contiguous blocks straight from the
+// queue; the completion interrupt retires a block and starts the next one.
+#ifndef STM32_USART_RX_DMA_SIZE
+#define STM32_USART_RX_DMA_SIZE 512
+#endif
+
+#define STM32_USART_DMA_FLAGS 0x3D // FEIF | DMEIF | TEIF | HTIF | TCIF (stream 0 position)
+
+struct STM32_USART_DMA_CONFIG
+{
+    DMA_TypeDef*        dma; // NULL: no stream, the port uses RXNE interrupts
+    DMA_Stream_TypeDef* stream;
+    UINT8               streamNum;
+    UINT8               channel;
+    UINT8               irq;
+};
+
+// rx streams by uart number, chosen to stay clear of the SPI streams (DMA1 S0/S3/S4/S7, DMA2 S0/S3);
+// UART5 can only use DMA1 S0, which belongs to SPI3
+static const STM32_USART_DMA_CONFIG g_STM32_UART_RxDmaConfig[] = {
+    {DMA2, DMA2_Stream5, 5, 4, DMA2_Stream5_IRQn},  // USART1
+    {DMA1, DMA1_Stream5, 5, 4, DMA1_Stream5_IRQn},  // USART2
+    {DMA1, DMA1_Stream1, 1, 4, DMA1_Stream1_IRQn},  // USART3
+    {DMA1, DMA1_Stream2, 2, 4, DMA1_Stream2_IRQn},  // UART4
+    {NULL, NULL,         0, 0, 0                },  // UART5
+    {DMA2, DMA2_Stream1, 1, 5, DMA2_Stream1_IRQn}}; // USART6
+
+// tx streams by uart number; USART3, UART4 and UART5 only have streams used by SPI2 and SPI3
+static const STM32_USART_DMA_CONFIG g_STM32_UART_TxDmaConfig[] = {
+    {DMA2, DMA2_Stream7, 7, 4, DMA2_Stream7_IRQn},  // USART1
+    {DMA1, DMA1_Stream6, 6, 4, DMA1_Stream6_IRQn},  // USART2
+    {NULL, NULL,         0, 0, 0                },  // USART3
+    {NULL, NULL,         0, 0, 0                },  // UART4
+    {NULL, NULL,         0, 0, 0                },  // UART5
+    {DMA2, DMA2_Stream6, 6, 5, DMA2_Stream6_IRQn}}; // USART6
+
+// DMA cannot reach CCM RAM, where some scatterfiles put RW/ZI data
+#pragma arm section zidata = "SectionForDmaBuffers"
+static UINT8  g_STM32_USART_RxDmaBuffer[TOTAL_USART_PORT][STM32_USART_RX_DMA_SIZE];
+#pragma arm section zidata
+static UINT16 g_STM32_USART_RxDmaTail[TOTAL_USART_PORT]; // first buffer position not yet handed to the PAL
+static BOOL   g_STM32_USART_RxDma[TOTAL_USART_PORT];     // port receives by DMA
+
+static const UINT8* g_STM32_USART_TxDmaData[TOTAL_USART_PORT]; // block being sent
+static UINT16       g_STM32_USART_TxDmaSize[TOTAL_USART_PORT]; // its length, 0 if the stream is idle
+static BOOL         g_STM32_USART_TxDma[TOTAL_USART_PORT];     // port transmits by DMA
+
+
+static inline UINT32 STM32_USART_DmaFlagShift( UINT32 stream )
+{
+    static const UINT8 shift[] = {0, 6, 16, 22};
+    return shift[stream & 3];
+}
+
+static inline UINT32 STM32_USART_DmaStatus( const STM32_USART_DMA_CONFIG& cfg )
+{
+    UINT32 isr = cfg.streamNum < 4 ? cfg.dma->LISR : cfg.dma->HISR;
+    return (isr >> STM32_USART_DmaFlagShift(cfg.streamNum)) & STM32_USART_DMA_FLAGS;
+}
+
+static inline void STM32_USART_DmaClearFlags( const STM32_USART_DMA_CONFIG& cfg, UINT32 flags )
+{
+    UINT32 mask = flags << STM32_USART_DmaFlagShift(cfg.streamNum);
+    if (cfg.streamNum < 4) cfg.dma->LIFCR = mask;
+    else                   cfg.dma->HIFCR = mask;
+}
+
+static inline void STM32_USART_DmaClear( const STM32_USART_DMA_CONFIG& cfg )
+{
+    STM32_USART_DmaClearFlags(cfg, STM32_USART_DMA_FLAGS);
+}
+
+static inline BOOL STM32_USART_DmaCapable( const void* buf )
+{
+    return ((UINT32)buf & 0xF0000000) != 0x10000000; // CCM data RAM is not reachable by DMA
+}
+
+// TRUE if the stream wrote buffer position pos on its way from tail to head
+static inline BOOL STM32_USART_RxDmaPassedPos( UINT32 tail, UINT32 head, UINT32 pos )
+{
+    UINT32 dist  = (head + STM32_USART_RX_DMA_SIZE - tail) % STM32_USART_RX_DMA_SIZE;
+    UINT32 ahead = (pos  + STM32_USART_RX_DMA_SIZE - tail) % STM32_USART_RX_DMA_SIZE;
+    return ahead != 0 && ahead <= dist;
+}
+
+// the half transfer (HT) and transfer complete (TC) flags the stream raises on its way from tail to head
+static inline UINT32 STM32_USART_RxDmaPassed( UINT32 tail, UINT32 head )
+{
+    UINT32 flags = 0;
+    if (STM32_USART_RxDmaPassedPos(tail, head, STM32_USART_RX_DMA_SIZE / 2)) flags |= DMA_LISR_HTIF0;
+    if (STM32_USART_RxDmaPassedPos(tail, head, 0)) flags |= DMA_LISR_TCIF0;
+    return flags;
+}
+
+// Passes everything the stream has written since the last call on to the PAL. The HT and TC
+// flags are consumed here rather than by the interrupt, so the IDLE drain keeps them in step:
+// a flag the stream raised without passing its position since the last drain means it lapped
+// the unread data.
+static void STM32_USART_RxDmaDrain( int ComPortNum )
+{
+    GLOBAL_LOCK(irq);
+
+    const STM32_USART_DMA_CONFIG& cfg = g_STM32_UART_RxDmaConfig[g_STM32_UART_UartNum[ComPortNum]];
+    UINT8* buf = g_STM32_USART_RxDmaBuffer[ComPortNum];
+    UINT32 tail = g_STM32_USART_RxDmaTail[ComPortNum];
+    UINT32 raised = STM32_USART_DmaStatus(cfg) & (DMA_LISR_HTIF0 | DMA_LISR_TCIF0);
+    STM32_USART_DmaClearFlags(cfg, raised);
+    UINT32 head = STM32_USART_RX_DMA_SIZE - cfg.stream->NDTR;
+    if (head >= STM32_USART_RX_DMA_SIZE) head = 0; // counter not reloaded yet
+
+    // a flag raised between the clear and reading NDTR belongs to a position already in head
+    UINT32 passed = STM32_USART_RxDmaPassed(tail, head);
+    STM32_USART_DmaClearFlags(cfg, STM32_USART_DmaStatus(cfg) & passed & ~raised);
+
+    if (raised & ~passed) { // lapped: the oldest unread data has been overwritten
+        USART_SetEvent(ComPortNum, USART_EVENT_ERROR_RXOVER);
+    }
+
+    if (head < tail) { // wrapped
+        USART_AddBlockToRxBuffer(ComPortNum, buf + tail, STM32_USART_RX_DMA_SIZE - tail);
+        tail = 0;
+    }
+    if (head > tail) {
+        USART_AddBlockToRxBuffer(ComPortNum, buf + tail, head - tail);
+    }
+    g_STM32_USART_RxDmaTail[ComPortNum] = head;
+}
+
+void STM32_USART_RxDmaInterrupt( void* param )
+{
+    INTERRUPT_START;
+
+    int ComPortNum = (int)param;
+    STM32_USART_DmaClearFlags(g_STM32_UART_RxDmaConfig[g_STM32_UART_UartNum[ComPortNum]],
+                              STM32_USART_DMA_FLAGS & ~(DMA_LISR_HTIF0 | DMA_LISR_TCIF0)); // HT and TC are the drain's
+    STM32_USART_RxDmaDrain(ComPortNum);
+
+    INTERRUPT_END;
+}
+
+// starts circular reception if the port has a stream; returns FALSE for RXNE interrupt reception
+static BOOL STM32_USART_RxDmaStart( int ComPortNum, USART_TypeDef* uart )
+{
+    const STM32_USART_DMA_CONFIG& cfg = g_STM32_UART_RxDmaConfig[g_STM32_UART_UartNum[ComPortNum]];
+
+    g_STM32_USART_RxDma[ComPortNum] = FALSE;
+    if (cfg.dma == NULL) return FALSE;
+    if (!STM32_USART_DmaCapable(g_STM32_USART_RxDmaBuffer[ComPortNum])) return FALSE; // not linked into SRAM
+
+    RCC->AHB1ENR |= cfg.dma == DMA1 ? RCC_AHB1ENR_DMA1EN : RCC_AHB1ENR_DMA2EN;
+
+    cfg.stream->CR = 0;
+    while (cfg.stream->CR & DMA_SxCR_EN); // wait for a previous run to stop
+    STM32_USART_DmaClear(cfg);
+
+    // peripheral to memory
+    cfg.stream->PAR  = (UINT32)&uart->DR;
+    cfg.stream->M0AR = (UINT32)g_STM32_USART_RxDmaBuffer[ComPortNum];
+    cfg.stream->NDTR = STM32_USART_RX_DMA_SIZE;
+    cfg.stream->FCR  = 0; // direct mode
+    cfg.stream->CR   = (cfg.channel * DMA_SxCR_CHSEL_0) | DMA_SxCR_PL_1 // high priority
+                     | DMA_SxCR_MINC | DMA_SxCR_CIRC | DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+
+    g_STM32_USART_RxDmaTail[ComPortNum] = 0;
+    g_STM32_USART_RxDma[ComPortNum] = TRUE;
+
+    CPU_INTC_ActivateInterrupt(cfg.irq, STM32_USART_RxDmaInterrupt, (void*)ComPortNum);
+    cfg.stream->CR |= DMA_SxCR_EN; // runs once USART_CR3_DMAR is set
+    return TRUE;
+}
+
+static void STM32_USART_RxDmaStop( int ComPortNum )
+{
+    if (!g_STM32_USART_RxDma[ComPortNum]) return;
+
+    const STM32_USART_DMA_CONFIG& cfg = g_STM32_UART_RxDmaConfig[g_STM32_UART_UartNum[ComPortNum]];
+    cfg.stream->CR = 0;
+    CPU_INTC_DeactivateInterrupt(cfg.irq);
+    STM32_USART_DmaClear(cfg);
+    g_STM32_USART_RxDma[ComPortNum] = FALSE;
+}
+
+// stops the stream and retires what it has sent of the current block; the rest stays queued
+static void STM32_USART_TxDmaComplete( int ComPortNum )
+{
+    const STM32_USART_DMA_CONFIG& cfg = g_STM32_UART_TxDmaConfig[g_STM32_UART_UartNum[ComPortNum]];
+
+    cfg.stream->CR = 0;
+    while (cfg.stream->CR & DMA_SxCR_EN);
+    STM32_USART_DmaClear(cfg);
+
+    UINT32 sent = g_STM32_USART_TxDmaSize[ComPortNum] - cfg.stream->NDTR;
+    g_STM32_USART_TxDmaSize[ComPortNum] = 0;
+
+    USART_TxBlockSent(ComPortNum, g_STM32_USART_TxDmaData[ComPortNum], sent);
+}
+
+// sends the next block of the TX queue unless one is in flight
+static void STM32_USART_TxDmaStart( int ComPortNum )
+{
+    if (g_STM32_USART_TxDmaSize[ComPortNum]) return; // the completion interrupt continues
+
+    const UINT8* data;
+    size_t size = USART_GetTxBlock(ComPortNum, data);
+    if (size == 0) return;
+
+    const STM32_USART_DMA_CONFIG& cfg = g_STM32_UART_TxDmaConfig[g_STM32_UART_UartNum[ComPortNum]];
+
+    if (!STM32_USART_DmaCapable(data)) { // queue not linked into SRAM: go back to TXE interrupts for good
+        USART_TypeDef* uart = g_STM32_Uart[ComPortNum];
+        CPU_INTC_DeactivateInterrupt(cfg.irq);
+        g_STM32_USART_TxDma[ComPortNum] = FALSE;
+        uart->CR3 &= ~USART_CR3_DMAT;
+        while (!(uart->SR & USART_SR_TXE)); // at most one character time
+        uart->DR = *data; // an XON/XOFF is not queued, send the fetched character here
+        USART_TxBlockSent(ComPortNum, data, 1);
+        uart->CR1 |= USART_CR1_TXEIE; // the rest is sent by the TXE interrupt
+        return;
+    }
+
+    g_STM32_USART_TxDmaData[ComPortNum] = data;
+    g_STM32_USART_TxDmaSize[ComPortNum] = (UINT16)size;
+
+    // memory to peripheral
+    STM32_USART_DmaClear(cfg);
+    cfg.stream->M0AR = (UINT32)data;
+    cfg.stream->NDTR = size;
+    cfg.stream->CR   = (cfg.channel * DMA_SxCR_CHSEL_0) | DMA_SxCR_PL_0 // medium priority
+                     | DMA_SxCR_DIR_0 | DMA_SxCR_MINC | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    cfg.stream->CR  |= DMA_SxCR_EN; // starts as soon as TXE is set
+}
+
+void STM32_USART_TxDmaInterrupt( void* param )
+{
+    INTERRUPT_START;
+
+    int ComPortNum = (int)param;
+    {
+        GLOBAL_LOCK(irq);
+
+        if (g_STM32_USART_TxDmaSize[ComPortNum]) {
+            STM32_USART_TxDmaComplete(ComPortNum);
+        } else { // already retired by a poller
+            STM32_USART_DmaClear(g_STM32_UART_TxDmaConfig[g_STM32_UART_UartNum[ComPortNum]]);
+        }
+        STM32_USART_TxDmaStart(ComPortNum); // e.g. the wrapped part of the queue
+    }
+
+    INTERRUPT_END;
+}
+
+// prepares the transmit stream; returns FALSE for TXE interrupt transmission
+static BOOL STM32_USART_TxDmaInit( int ComPortNum, USART_TypeDef* uart )
+{
+    const STM32_USART_DMA_CONFIG& cfg = g_STM32_UART_TxDmaConfig[g_STM32_UART_UartNum[ComPortNum]];
+
+    g_STM32_USART_TxDma[ComPortNum] = FALSE;
+    if (cfg.dma == NULL) return FALSE;
+
+    RCC->AHB1ENR |= cfg.dma == DMA1 ? RCC_AHB1ENR_DMA1EN : RCC_AHB1ENR_DMA2EN;
+
+    cfg.stream->CR = 0;
+    while (cfg.stream->CR & DMA_SxCR_EN);
+    STM32_USART_DmaClear(cfg);
+
+    cfg.stream->PAR = (UINT32)&uart->DR;
+    cfg.stream->FCR = 0; // direct mode
+
+    g_STM32_USART_TxDmaSize[ComPortNum] = 0;
+    g_STM32_USART_TxDma[ComPortNum] = TRUE;
+
+    CPU_INTC_ActivateInterrupt(cfg.irq, STM32_USART_TxDmaInterrupt, (void*)ComPortNum);
+    return TRUE;
+}
+
+static void STM32_USART_TxDmaStop( int ComPortNum )
+{
+    if (!g_STM32_USART_TxDma[ComPortNum]) return;
+
+    const STM32_USART_DMA_CONFIG& cfg = g_STM32_UART_TxDmaConfig[g_STM32_UART_UartNum[ComPortNum]];
+    if (g_STM32_USART_TxDmaSize[ComPortNum]) STM32_USART_TxDmaComplete(ComPortNum);
+    cfg.stream->CR = 0;
+    CPU_INTC_DeactivateInterrupt(cfg.irq);
+    STM32_USART_DmaClear(cfg);
+    g_STM32_USART_TxDma[ComPortNum] = FALSE;
+}
+#endif
+
 
 void STM32_USART_Handle_RX_IRQ (int ComPortNum, USART_TypeDef* uart)
 {
     INTERRUPT_START;
 
     char c = (char)(uart->DR); // read RX data
-    USART_AddCharToRxBuffer(ComPortNum, c);
-    Events_Set(SYSTEM_EVENT_FLAG_COM_IN);
+    USART_AddCharToRxBuffer(ComPortNum, c); // raises SYSTEM_EVENT_FLAG_COM_IN unless a frame read is pending
 
     INTERRUPT_END;
 }
@@ -69,70 +363,76 @@ void STM32_USART_Handle_TX_IRQ (int ComPortNum, USART_TypeDef* uart)
     INTERRUPT_END;
 }
 
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+void STM32_USART_Handle_IDLE_IRQ (int ComPortNum, USART_TypeDef* uart, UINT16 sr)
+{
+    INTERRUPT_START;
+
+    // SR then DR read clears IDLE; a received character is left to the stream,
+    // whose DR read clears the flag just as well
+    if (!(sr & USART_SR_RXNE)) (void)uart->DR;
+    STM32_USART_RxDmaDrain(ComPortNum);
+
+    INTERRUPT_END;
+}
+#endif
+
+void STM32_USART_Handle_IRQ (int ComPortNum, USART_TypeDef* uart)
+{
+    UINT16 sr = uart->SR;
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+    if (g_STM32_USART_RxDma[ComPortNum]) {
+        // DR belongs to the DMA stream, IDLE ends a burst
+        if ((sr & USART_SR_IDLE) && (uart->CR1 & USART_CR1_IDLEIE)) STM32_USART_Handle_IDLE_IRQ(ComPortNum, uart, sr);
+    } else
+#endif
+    if (sr & USART_SR_RXNE) STM32_USART_Handle_RX_IRQ(ComPortNum, uart);
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+    if (g_STM32_USART_TxDma[ComPortNum]) return; // the DMA stream feeds DR
+#endif
+    if (sr & USART_SR_TXE)  STM32_USART_Handle_TX_IRQ(ComPortNum, uart);
+}
+
 void STM32_USART_Interrupt0(void* param)
 {
 #if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
-    USART_TypeDef* uart = g_STM32_Uart[0];
-    UINT16 sr = uart->SR;
-    if (sr & USART_SR_RXNE) STM32_USART_Handle_RX_IRQ(0, uart);
-    if (sr & USART_SR_TXE)  STM32_USART_Handle_TX_IRQ(0, uart);
+    STM32_USART_Handle_IRQ(0, g_STM32_Uart[0]);
 #else
-    UINT16 sr = USART1->SR;
-    if (sr & USART_SR_RXNE) STM32_USART_Handle_RX_IRQ(0, USART1);
-    if (sr & USART_SR_TXE)  STM32_USART_Handle_TX_IRQ(0, USART1);
+    STM32_USART_Handle_IRQ(0, USART1);
 #endif
 }
 
 void STM32_USART_Interrupt1(void* param)
 {
 #if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
-    USART_TypeDef* uart = g_STM32_Uart[1];
-    UINT16 sr = uart->SR;
-    if (sr & USART_SR_RXNE) STM32_USART_Handle_RX_IRQ(1, uart);
-    if (sr & USART_SR_TXE)  STM32_USART_Handle_TX_IRQ(1, uart);
+    STM32_USART_Handle_IRQ(1, g_STM32_Uart[1]);
 #else
-    UINT16 sr = USART2->SR;
-    if (sr & USART_SR_RXNE) STM32_USART_Handle_RX_IRQ(1, USART2);
-    if (sr & USART_SR_TXE)  STM32_USART_Handle_TX_IRQ(1, USART2);
+    STM32_USART_Handle_IRQ(1, USART2);
 #endif
 }
 
 void STM32_USART_Interrupt2(void* param)
 {
 #if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
-    USART_TypeDef* uart = g_STM32_Uart[2];
-    UINT16 sr = uart->SR;
-    if (sr & USART_SR_RXNE) STM32_USART_Handle_RX_IRQ(2, uart);
-    if (sr & USART_SR_TXE)  STM32_USART_Handle_TX_IRQ(2, uart);
+    STM32_USART_Handle_IRQ(2, g_STM32_Uart[2]);
 #else
-    UINT16 sr = USART3->SR;
-    if (sr & USART_SR_RXNE) STM32_USART_Handle_RX_IRQ(2, USART3);
-    if (sr & USART_SR_TXE)  STM32_USART_Handle_TX_IRQ(2, USART3);
+    STM32_USART_Handle_IRQ(2, USART3);
 #endif
 }
 
 void STM32_USART_Interrupt3(void* param)
 {
-    USART_TypeDef* uart = g_STM32_Uart[3];
-    UINT16 sr = uart->SR;
-    if (sr & USART_SR_RXNE) STM32_USART_Handle_RX_IRQ(3, uart);
-    if (sr & USART_SR_TXE)  STM32_USART_Handle_TX_IRQ(3, uart);
+    STM32_USART_Handle_IRQ(3, g_STM32_Uart[3]);
 }
 
 void STM32_USART_Interrupt4(void* param)
 {
-    USART_TypeDef* uart = g_STM32_Uart[4];
-    UINT16 sr = uart->SR;
-    if (sr & USART_SR_RXNE) STM32_USART_Handle_RX_IRQ(4, uart);
-    if (sr & USART_SR_TXE)  STM32_USART_Handle_TX_IRQ(4, uart);
+    STM32_USART_Handle_IRQ(4, g_STM32_Uart[4]);
 }
 
 void STM32_USART_Interrupt5(void* param)
 {
-    USART_TypeDef* uart = g_STM32_Uart[5];
-    UINT16 sr = uart->SR;
-    if (sr & USART_SR_RXNE) STM32_USART_Handle_RX_IRQ(5, uart);
-    if (sr & USART_SR_TXE)  STM32_USART_Handle_TX_IRQ(5, uart);
+    STM32_USART_Handle_IRQ(5, g_STM32_Uart[5]);
 }
 
 BOOL CPU_USART_Initialize( int ComPortNum, int BaudRate, int Parity, int DataBits, int StopBits, int FlowValue )
@@ -208,8 +508,16 @@ BOOL CPU_USART_Initialize( int ComPortNum, int BaudRate, int Parity, int DataBit
     ctrl = 0;
     if ((FlowValue & USART_FLOW_HW_OUT_EN) & ctsPin != 0xFF) ctrl |= USART_CR3_CTSE;
     if ((FlowValue & USART_FLOW_HW_IN_EN) & rtsPin != 0xFF)  ctrl |= USART_CR3_RTSE;
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+    if (STM32_USART_TxDmaInit(ComPortNum, uart)) ctrl |= USART_CR3_DMAT;
+#endif
     uart->CR3 = ctrl;
 
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+    // DMA requests and the IDLE interrupt are switched on with the receiver by CPU_USART_ProtectPins below
+    STM32_USART_RxDmaStart(ComPortNum, uart);
+#endif
+
     //CPU_GPIO_DisablePin(rxPin, RESISTOR_PULLUP, 0, GPIO_ALT_MODE_5); // should we pull up RX by default?
 #if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
     CPU_GPIO_DisablePin(rxPin, RESISTOR_DISABLED, 0, GPIO_ALT_MODE_5); // alternate input
@@ -286,6 +594,8 @@ BOOL CPU_USART_Uninitialize( int ComPortNum )
 
     uart->CR1 = 0; // stop uart
     CPU_INTC_DeactivateInterrupt(g_STM32_UART_Irq[uartNum]);
+    STM32_USART_RxDmaStop(ComPortNum);
+    STM32_USART_TxDmaStop(ComPortNum);
 #else
     g_STM32_Uart[ComPortNum]->CR1 = 0; // stop uart
 
@@ -322,6 +632,16 @@ BOOL CPU_USART_Uninitialize( int ComPortNum )
 
 BOOL CPU_USART_TxBufferEmpty( int ComPortNum )
 {
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+    if (g_STM32_USART_TxDmaSize[ComPortNum]) {
+        // DR belongs to the stream until its block is done; retiring it here
+        // lets callers poll with interrupts off
+        GLOBAL_LOCK(irq);
+        const STM32_USART_DMA_CONFIG& cfg = g_STM32_UART_TxDmaConfig[g_STM32_UART_UartNum[ComPortNum]];
+        if (!(STM32_USART_DmaStatus(cfg) & (DMA_LISR_TCIF0 | DMA_LISR_TEIF0))) return FALSE;
+        STM32_USART_TxDmaComplete(ComPortNum);
+    }
+#endif
     if (g_STM32_Uart[ComPortNum]->SR & USART_SR_TXE) return TRUE;
     return FALSE;
 }
@@ -343,6 +663,18 @@ void CPU_USART_WriteCharToTxBuffer( int ComPortNum, UINT8 c )
 void CPU_USART_TxBufferEmptyInterruptEnable( int ComPortNum, BOOL Enable )
 {
     USART_TypeDef* uart = g_STM32_Uart[ComPortNum];
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+    if (g_STM32_USART_TxDma[ComPortNum]) {
+        // the transmit stream takes the place of the TXE interrupt
+        GLOBAL_LOCK(irq);
+        if (Enable) {
+            STM32_USART_TxDmaStart(ComPortNum);
+        } else if (g_STM32_USART_TxDmaSize[ComPortNum]) {
+            STM32_USART_TxDmaComplete(ComPortNum);
+        }
+        return;
+    }
+#endif
     if (Enable) {
         uart->CR1 |= USART_CR1_TXEIE;  // tx int enable
     } else {
@@ -352,6 +684,9 @@ void CPU_USART_TxBufferEmptyInterruptEnable( int ComPortNum, BOOL Enable )
 
 BOOL CPU_USART_TxBufferEmptyInterruptState( int ComPortNum )
 {
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+    if (g_STM32_USART_TxDma[ComPortNum]) return g_STM32_USART_TxDmaSize[ComPortNum] != 0;
+#endif
     if (g_STM32_Uart[ComPortNum]->CR1 & USART_CR1_TXEIE) return TRUE;
     return FALSE;
 }
@@ -359,6 +694,21 @@ BOOL CPU_USART_TxBufferEmptyInterruptState( int ComPortNum )
 void CPU_USART_RxBufferFullInterruptEnable( int ComPortNum, BOOL Enable )
 {
     USART_TypeDef* uart = g_STM32_Uart[ComPortNum];
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+    if (g_STM32_USART_RxDma[ComPortNum]) {
+        // without DMA requests the next character stays in DR, which holds RTS off
+        // just like an unserviced RXNE interrupt; the IDLE handler must not read it either
+        GLOBAL_LOCK(irq);
+        if (Enable) {
+            uart->CR3 |= USART_CR3_DMAR;  // rx dma enable
+            uart->CR1 |= USART_CR1_IDLEIE;
+        } else {
+            uart->CR1 &= ~USART_CR1_IDLEIE;
+            uart->CR3 &= ~USART_CR3_DMAR; // rx dma disable
+        }
+        return;
+    }
+#endif
     if (Enable) {
         uart->CR1 |= USART_CR1_RXNEIE;  // rx int enable
     } else {
@@ -368,6 +718,9 @@ void CPU_USART_RxBufferFullInterruptEnable( int ComPortNum, BOOL Enable )
 
 BOOL CPU_USART_RxBufferFullInterruptState( int ComPortNum )
 {
+#if defined(PLATFORM_ARM_STM32F2_ANY) || defined(PLATFORM_ARM_STM32F4_ANY)
+    if (g_STM32_USART_RxDma[ComPortNum]) return (g_STM32_Uart[ComPortNum]->CR3 & USART_CR3_DMAR) != 0;
+#endif
     if (g_STM32_Uart[ComPortNum]->CR1 & USART_CR1_RXNEIE) return TRUE;
 
     return FALSE;
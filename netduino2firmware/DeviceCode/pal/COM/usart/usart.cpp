@@ -11,6 +11,11 @@
 static const INT8 XOFF_FLAG_FULL  = 0x01;
 static const INT8 XOFF_CLOCK_HALT = 0x02;
 
+// XON/XOFF handed out by GetTxBlock (in RAM, a DMA controller reads them)
+#pragma arm section rwdata = "SectionForDmaBuffers"
+static UINT8 TxFlowChars[] = { XOFF, XON };
+#pragma arm section rwdata
+
 //--//
 
 
@@ -34,6 +39,11 @@ int USART_Read( int ComPortNum, char* Data, size_t size )
     return USART_Driver::Read( ComPortNum, Data, size );
 }
 
+int USART_ReadFrame( int ComPortNum, char* Data, size_t size, int Delimiter, size_t WakeCount, BOOL& fComplete, UINT64& LastRxTicks )
+{
+    return USART_Driver::ReadFrame( ComPortNum, Data, size, Delimiter, WakeCount, fComplete, LastRxTicks );
+}
+
 BOOL USART_Flush( int ComPortNum )
 {
     return USART_Driver::Flush( ComPortNum );
@@ -44,11 +54,26 @@ BOOL USART_AddCharToRxBuffer( int ComPortNum, char c )
     return USART_Driver::AddCharToRxBuffer( ComPortNum, c );
 }
 
+BOOL USART_AddBlockToRxBuffer( int ComPortNum, const UINT8* Data, size_t size )
+{
+    return USART_Driver::AddBlockToRxBuffer( ComPortNum, Data, size );
+}
+
 BOOL USART_RemoveCharFromTxBuffer( int ComPortNum, char& c )
 {
     return USART_Driver::RemoveCharFromTxBuffer( ComPortNum, c );
 }
 
+size_t USART_GetTxBlock( int ComPortNum, const UINT8*& Data )
+{
+    return USART_Driver::GetTxBlock( ComPortNum, Data );
+}
+
+void USART_TxBlockSent( int ComPortNum, const UINT8* Data, size_t size )
+{
+    USART_Driver::TxBlockSent( ComPortNum, Data, size );
+}
+
 INT8 USART_PowerSave( int ComPortNum, INT8 Enable )
 {
     return USART_Driver::PowerSave( ComPortNum, Enable );
@@ -126,13 +151,20 @@ void USART_SetEvent( int ComPortNum, unsigned int event )
 #define RX_USART_BUFFER_SIZE    512
 #endif
 
+// longest block GetTxBlock hands out while RX software flow control may need to send an XOFF
+#ifndef USART_TX_BLOCK_SIZE_SWFLOW
+#define USART_TX_BLOCK_SIZE_SWFLOW  16
+#endif
+
 //--//
 
 #if TOTAL_USART_PORT == 0
 UINT8 TxBuffer_Com[1];     // Allows compile to complete although in this case it won't be linked
 UINT8 RxBuffer_Com[1];
 #else
+#pragma arm section zidata = "SectionForDmaBuffers" // sent by DMA straight from the queue
 UINT8 TxBuffer_Com[TX_USART_BUFFER_SIZE * TOTAL_USART_PORT];
+#pragma arm section zidata
 UINT8 RxBuffer_Com[RX_USART_BUFFER_SIZE * TOTAL_USART_PORT];
 #endif
 
@@ -172,6 +204,11 @@ struct HAL_USART_STATE
     size_t                         RxBufferHighWaterMark;
     size_t                         RxBufferLowWaterMark;
 
+    // pending ReadFrame: COM_IN is held back until this many characters or the delimiter are queued
+    size_t                         RxFrameSize;
+    INT32                          RxFrameDelimiter;
+    volatile UINT64                RxLastTicks;
+
     BOOL fDataEventSet;
  
     UINT32 PortIndex;
@@ -246,6 +283,9 @@ BOOL USART_Driver::Initialize( int ComPortNum, int BaudRate, int Parity, int Dat
 
             State.TicksStartTxXOFF      = 0;
 
+            State.RxFrameSize           = 0;
+            State.RxLastTicks           = 0;
+
             State.TxQueue.Initialize( &TxBuffer_Com[ComPortNum * TX_USART_BUFFER_SIZE], TX_USART_BUFFER_SIZE);
             State.RxQueue.Initialize( &RxBuffer_Com[ComPortNum * RX_USART_BUFFER_SIZE], RX_USART_BUFFER_SIZE );
 
@@ -277,6 +317,8 @@ BOOL USART_Driver::Uninitialize( int ComPortNum )
 
             CLEAR_USART_FLAG(State,HAL_USART_STATE::c_INITIALIZED);
 
+            State.RxFrameSize = 0;
+
             return CPU_USART_Uninitialize( ComPortNum );
         }
 
@@ -403,6 +445,9 @@ int USART_Driver::Read( int ComPortNum, char* Data, size_t size )
     {
         GLOBAL_LOCK(irq);
 
+        // a plain read takes over from a pending frame read
+        State.RxFrameSize = 0;
+
 #if defined(PLATFORM_ARM_Netduino2) || defined(PLATFORM_ARM_NetduinoPlus2) || defined(PLATFORM_ARM_NetduinoGo) || defined(PLATFORM_ARM_NetduinoShieldBase)
 #else
         State.fDataEventSet  = FALSE;        
@@ -418,6 +463,85 @@ int USART_Driver::Read( int ComPortNum, char* Data, size_t size )
 }
 
 
+// Reads up to size characters, stopping after Delimiter (-1 for none). fComplete reports whether
+// the frame is done. If it is not, the reader is armed: the receive path holds back
+// SYSTEM_EVENT_FLAG_COM_IN for this port until WakeCount characters (0: the rest of the frame), the
+// delimiter or the high water mark are queued, so a frame costs one wakeup instead of one per burst.
+// LastRxTicks is the arrival time of the newest character, for inter-character timeouts.
+// A zero length read disarms the reader.
+int USART_Driver::ReadFrame( int ComPortNum, char* Data, size_t size, int Delimiter, size_t WakeCount, BOOL& fComplete, UINT64& LastRxTicks )
+{
+    NATIVE_PROFILE_PAL_COM();
+    if((ComPortNum < 0) || (ComPortNum >= TOTAL_USART_PORT)) {ASSERT(FALSE); return -1;}
+    if(Data == NULL && size != 0                           )                 return -1;
+
+    HAL_USART_STATE& State = Hal_Usart_State[ComPortNum];
+
+    if ( IS_POWERSAVE_ENABLED(State) || (!IS_USART_INITIALIZED(State))) return -1;
+
+    size_t CharsRead = 0;
+
+    fComplete = FALSE;
+
+    GLOBAL_LOCK(irq);
+
+    while(CharsRead < size && !fComplete)
+    {
+        UINT8* Src = State.RxQueue.Peek();
+
+        if(NULL == Src)
+            break;
+
+        // take the contiguous part of the queue, the wrapped part follows in the next pass
+        size_t toRead = State.RxQueue.NumberOfElements();
+        size_t toEnd  = &RxBuffer_Com[(ComPortNum + 1) * RX_USART_BUFFER_SIZE] - Src;
+
+        if(toRead > toEnd           ) toRead = toEnd;
+        if(toRead > size - CharsRead) toRead = size - CharsRead;
+
+        if(Delimiter >= 0)
+        {
+            for(size_t i = 0; i < toRead; i++)
+            {
+                if(Src[i] == (UINT8)Delimiter)
+                {
+                    toRead    = i + 1;
+                    fComplete = TRUE;
+                    break;
+                }
+            }
+        }
+
+        State.RxQueue.Pop( toRead );
+
+        // Check if FIFO level has just passed or gotten down to the low water mark
+        if(State.RxQueue.NumberOfElements() <= State.RxBufferLowWaterMark && (State.RxQueue.NumberOfElements() + toRead) > State.RxBufferLowWaterMark)
+        {
+            if( USART_FLAG_STATE(State, HAL_USART_STATE::c_RX_SWFLOW_CTRL) )
+            {
+                // Clear our XOFF state
+                SendXON( ComPortNum, XOFF_FLAG_FULL );
+            }
+            if( USART_FLAG_STATE(State, HAL_USART_STATE::c_RX_HWFLOW_CTRL) )
+            {
+                CPU_USART_RxBufferFullInterruptEnable(ComPortNum, TRUE);
+            }
+        }
+        memcpy(&Data[CharsRead], Src, toRead);   // Copy data from queue to Read buffer
+        CharsRead += toRead;
+    }
+
+    if(CharsRead == size) fComplete = TRUE;
+
+    State.RxFrameSize      = fComplete ? 0 : (WakeCount ? WakeCount : size - CharsRead);
+    State.RxFrameDelimiter = Delimiter;
+
+    LastRxTicks = State.RxLastTicks;
+
+    return (int)CharsRead;
+}
+
+
 BOOL USART_Driver::Flush( int ComPortNum )
 {
     NATIVE_PROFILE_PAL_COM();
@@ -515,6 +639,32 @@ BOOL USART_Driver::Flush( int ComPortNum )
 
 //--//
 
+// FALSE while a pending ReadFrame still waits for more of its frame; clears the frame otherwise
+static BOOL USART_RxFrameWake( HAL_USART_STATE& State, const UINT8* Data, size_t size )
+{
+    if(State.RxFrameSize == 0) return TRUE;
+
+    size_t nElements = State.RxQueue.NumberOfElements();
+
+    // the queue must not fill up behind a reader that is asleep
+    if(nElements < State.RxFrameSize && nElements < State.RxBufferHighWaterMark)
+    {
+        if(State.RxFrameDelimiter < 0) return FALSE;
+
+        while(size > 0 && *Data != (UINT8)State.RxFrameDelimiter)
+        {
+            Data++;
+            size--;
+        }
+
+        if(size == 0) return FALSE;
+    }
+
+    State.RxFrameSize = 0;
+
+    return TRUE;
+}
+
 BOOL USART_Driver::AddCharToRxBuffer( int ComPortNum, char c )
 {
     ASSERT_IRQ_MUST_BE_OFF();
@@ -539,6 +689,8 @@ BOOL USART_Driver::AddCharToRxBuffer( int ComPortNum, char c )
     }
 
 
+    BOOL fWake;
+
     {
         GLOBAL_LOCK(irq);
 
@@ -548,6 +700,10 @@ BOOL USART_Driver::AddCharToRxBuffer( int ComPortNum, char c )
         {
             *Dst = c;
 
+            State.RxLastTicks = HAL_Time_CurrentTicks();
+
+            fWake = USART_RxFrameWake( State, Dst, 1 );
+
             if( State.RxQueue.NumberOfElements() >= State.RxBufferHighWaterMark )
             {
                 if( USART_FLAG_STATE(State, HAL_USART_STATE::c_RX_SWFLOW_CTRL) )
@@ -577,11 +733,124 @@ BOOL USART_Driver::AddCharToRxBuffer( int ComPortNum, char c )
 
     SetEvent( ComPortNum, USART_EVENT_DATA_CHARS );
 
-    Events_Set( SYSTEM_EVENT_FLAG_COM_IN );
+    if(fWake)
+    {
+        Events_Set( SYSTEM_EVENT_FLAG_COM_IN );
+    }
 
     return TRUE;
 }
 
+// Block version of AddCharToRxBuffer for drivers that receive a burst at a time (e.g. by DMA).
+// XON/XOFF are filtered exactly as in the per character path, but the queue is locked, the
+// water mark checked and the data event raised once per block instead of once per character.
+BOOL USART_Driver::AddBlockToRxBuffer( int ComPortNum, const UINT8* Data, size_t size )
+{
+    ASSERT_IRQ_MUST_BE_OFF();
+
+    if((ComPortNum < 0) || (ComPortNum >= TOTAL_USART_PORT)) return FALSE;
+    if(0 == size) return TRUE;
+
+    HAL_USART_STATE& State = Hal_Usart_State[ComPortNum];
+
+    const UINT8* Block     = Data;
+    size_t       nAdded    = 0;
+    BOOL         fOverflow = FALSE;
+    BOOL         fWake     = FALSE;
+
+    {
+        GLOBAL_LOCK(irq);
+
+        while(size > 0)
+        {
+            size_t run = size;
+
+            if (USART_FLAG_STATE(State, HAL_USART_STATE::c_TX_SWFLOW_CTRL))
+            {
+                // stop the run at the next flow control character
+                for(run = 0; run < size; run++)
+                {
+                    if(Data[run] == XON || Data[run] == XOFF) break;
+                }
+
+                if(run == 0)
+                {
+                    if(*Data == XOFF)
+                    {
+                        State.TicksStartTxXOFF = HAL_Time_CurrentTicks();
+                        CLEAR_USART_FLAG(State, HAL_USART_STATE::c_TX_XON_STATE);
+                    }
+                    else
+                    {
+                        SET_USART_FLAG(State, HAL_USART_STATE::c_TX_XON_STATE);
+                    }
+
+                    Data++;
+                    size--;
+                    continue;
+                }
+            }
+
+            // the queue is circular, so a run may take two pushes
+            UINT8* Dst = State.RxQueue.Push( run );
+
+            if(Dst == NULL)
+            {
+                fOverflow = TRUE;
+                break;
+            }
+
+            memcpy(Dst, Data, run);
+            Data   += run;
+            size   -= run;
+            nAdded += run;
+        }
+
+        if(nAdded)
+        {
+            State.RxLastTicks = HAL_Time_CurrentTicks();
+
+            fWake = USART_RxFrameWake( State, Block, Data - Block );
+        }
+
+        if(nAdded && State.RxQueue.NumberOfElements() >= State.RxBufferHighWaterMark)
+        {
+            if( USART_FLAG_STATE(State, HAL_USART_STATE::c_RX_SWFLOW_CTRL) )
+            {
+                // Set our XOFF state
+                SendXOFF( ComPortNum, XOFF_FLAG_FULL );
+            }
+            if( USART_FLAG_STATE(State, HAL_USART_STATE::c_RX_HWFLOW_CTRL) )
+            {
+                // Hold off receiving characters (should pull HW handshake automatically)
+                CPU_USART_RxBufferFullInterruptEnable(ComPortNum, FALSE);
+            }
+        }
+    }
+
+    if(fOverflow)
+    {
+        SetEvent( ComPortNum, USART_EVENT_ERROR_RXOVER );
+
+#if !defined(BUILD_RTM)
+        lcd_printf("\fBuffer OVFLW\r\n");
+        hal_printf("Buffer OVFLW\r\n");
+#endif
+    }
+
+    if(nAdded)
+    {
+        SetEvent( ComPortNum, USART_EVENT_DATA_CHARS );
+    }
+
+    if(fWake)
+    {
+        Events_Set( SYSTEM_EVENT_FLAG_COM_IN );
+    }
+
+    return !fOverflow;
+}
+
 BOOL USART_Driver::RemoveCharFromTxBuffer( int ComPortNum, char& c )
 {
     if((ComPortNum < 0) || (ComPortNum >= TOTAL_USART_PORT)) return FALSE;
@@ -620,6 +889,72 @@ BOOL USART_Driver::RemoveCharFromTxBuffer( int ComPortNum, char& c )
     }
 }
 
+// Block transmit for drivers that move data by DMA. GetTxBlock returns the next contiguous run of
+// the TX queue without removing it, so Write cannot reuse the memory while it is being sent;
+// TxBlockSent removes it afterwards. A pending XON/XOFF is returned first as a run of its own.
+size_t USART_Driver::GetTxBlock( int ComPortNum, const UINT8*& Data )
+{
+    if((ComPortNum < 0) || (ComPortNum >= TOTAL_USART_PORT)) return 0;
+
+    HAL_USART_STATE& State = Hal_Usart_State[ComPortNum];
+
+    {
+        GLOBAL_LOCK(irq);
+
+        if (USART_FLAG_STATE(State,HAL_USART_STATE::c_TX_BUFFERXOFF))
+        {
+            CLEAR_USART_FLAG(State,HAL_USART_STATE::c_TX_BUFFERXOFF);
+            Data = &TxFlowChars[0];
+            return 1;
+        }
+
+        if( USART_FLAG_STATE(State,HAL_USART_STATE::c_TX_BUFFERXON))
+        {
+            CLEAR_USART_FLAG(State, HAL_USART_STATE::c_TX_BUFFERXON);
+            Data = &TxFlowChars[1];
+            return 1;
+        }
+
+        UINT8* Src = State.TxQueue.Peek();
+
+        if(Src == NULL) return 0;
+
+        // stop at the end of the buffer, the wrapped part is the next block
+        size_t size  = State.TxQueue.NumberOfElements();
+        size_t toEnd = &TxBuffer_Com[(ComPortNum + 1) * TX_USART_BUFFER_SIZE] - Src;
+
+        if(size > toEnd) size = toEnd;
+
+        // an XOFF can only go out between blocks
+        if(USART_FLAG_STATE(State, HAL_USART_STATE::c_RX_SWFLOW_CTRL) && size > USART_TX_BLOCK_SIZE_SWFLOW)
+        {
+            size = USART_TX_BLOCK_SIZE_SWFLOW;
+        }
+
+        Data = Src;
+        return size;
+    }
+}
+
+void USART_Driver::TxBlockSent( int ComPortNum, const UINT8* Data, size_t size )
+{
+    if((ComPortNum < 0) || (ComPortNum >= TOTAL_USART_PORT)) return;
+
+    HAL_USART_STATE& State = Hal_Usart_State[ComPortNum];
+
+    {
+        GLOBAL_LOCK(irq);
+
+        // XON/XOFF are not queued, and a block discarded while it was sent is gone already
+        if(size && State.TxQueue.Peek() == Data)
+        {
+            State.TxQueue.Pop( size );
+        }
+    }
+
+    Events_Set(SYSTEM_EVENT_FLAG_COM_OUT);
+}
+
 
 INT8 USART_Driver::PowerSave( int ComPortNum, INT8 Enable )
 {
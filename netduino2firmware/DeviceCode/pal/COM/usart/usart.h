@@ -16,10 +16,14 @@ struct USART_Driver
 
     static int  Write( int ComPortNum, const char* Data, size_t size );
     static int  Read ( int ComPortNum, char*       Data, size_t size );
+    static int  ReadFrame( int ComPortNum, char* Data, size_t size, int Delimiter, size_t WakeCount, BOOL& fComplete, UINT64& LastRxTicks );
     static BOOL Flush( int ComPortNum                                );
 
     static BOOL AddCharToRxBuffer     ( int ComPortNum, char  c     );
+    static BOOL AddBlockToRxBuffer    ( int ComPortNum, const UINT8* Data, size_t size );
     static BOOL RemoveCharFromTxBuffer( int ComPortNum, char& c     );
+    static size_t GetTxBlock          ( int ComPortNum, const UINT8*& Data );
+    static void TxBlockSent           ( int ComPortNum, const UINT8* Data, size_t size );
     static INT8 PowerSave             ( int ComPortNum, INT8 Enable );
 
     static void PrepareForClockStop();
@@ -371,8 +371,11 @@ int LWIP_SOCKETS_Driver::GetLastError()
     return GetNativeError(errno);
 }
 
+// returns the highest socket in the set plus one, the scan limit for lwip_select
 static int MARSHAL_SOCK_FDSET_TO_FDSET(SOCK_fd_set *sf, fd_set *f)
 {
+    int maxfdp1 = 0;
+
     if(f != NULL && sf != NULL) 
     { 
         FD_ZERO(f);
@@ -380,19 +383,25 @@ static int MARSHAL_SOCK_FDSET_TO_FDSET(SOCK_fd_set *sf, fd_set *f)
         for(int i=0; i<sf->fd_count; i++) 
         { 
             FD_SET(sf->fd_array[i], f); 
+
+            if(sf->fd_array[i] >= maxfdp1)
+            {
+                maxfdp1 = sf->fd_array[i] + 1;
+            }
         } 
-        return sf->fd_count;
     } 
 
-    return 0;
+    return maxfdp1;
 }
 
 static void MARSHAL_FDSET_TO_SOCK_FDSET(SOCK_fd_set *sf, fd_set *f)
 {
     if(sf != NULL && f != NULL) 
     { 
+        int count = sf->fd_count;
+
         sf->fd_count = 0; 
-        for(int i=0; i<sf->fd_count; i++) 
+        for(int i=0; i<count; i++) 
         { 
             if(FD_ISSET(sf->fd_array[i],f)) 
             { 
@@ -408,6 +417,7 @@ int LWIP_SOCKETS_Driver::Select( int nfds, SOCK_fd_set* readfds, SOCK_fd_set* wr
 {
     NATIVE_PROFILE_PAL_NETWORK();
     int ret = 0;
+    int maxfdp1, n;
 
     fd_set read;
     fd_set write;
@@ -436,11 +446,16 @@ int LWIP_SOCKETS_Driver::Select( int nfds, SOCK_fd_set* readfds, SOCK_fd_set* wr
         }
     }
 
-    MARSHAL_SOCK_FDSET_TO_FDSET(readfds  , pR);
-    MARSHAL_SOCK_FDSET_TO_FDSET(writefds , pW);
-    MARSHAL_SOCK_FDSET_TO_FDSET(exceptfds, pE);
+    // only scan up to the highest socket asked for, not every netconn
+    maxfdp1 = MARSHAL_SOCK_FDSET_TO_FDSET(readfds  , pR);
+
+    n = MARSHAL_SOCK_FDSET_TO_FDSET(writefds , pW);
+    if(n > maxfdp1) maxfdp1 = n;
+
+    n = MARSHAL_SOCK_FDSET_TO_FDSET(exceptfds, pE);
+    if(n > maxfdp1) maxfdp1 = n;
 
-    ret = lwip_select(MEMP_NUM_NETCONN, pR, pW, pE, (struct timeval *)timeout);
+    ret = lwip_select(maxfdp1, pR, pW, pE, (struct timeval *)timeout);
 
     MARSHAL_FDSET_TO_SOCK_FDSET(readfds  , pR);
     MARSHAL_FDSET_TO_SOCK_FDSET(writefds , pW);
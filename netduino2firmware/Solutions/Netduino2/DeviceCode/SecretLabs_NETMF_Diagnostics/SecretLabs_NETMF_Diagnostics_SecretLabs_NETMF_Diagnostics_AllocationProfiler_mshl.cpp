@@ -0,0 +1,47 @@
+//-----------------------------------------------------------------------------
+//
+//    ** DO NOT EDIT THIS FILE! **
+//    This file was generated by a tool
+//    re-running the tool will overwrite this file.
+//
+//-----------------------------------------------------------------------------
+
+
+#include "SecretLabs_NETMF_Diagnostics.h"
+#include "SecretLabs_NETMF_Diagnostics_SecretLabs_NETMF_Diagnostics_AllocationProfiler.h"
+
+using namespace SecretLabs::NETMF::Diagnostics;
+
+
+HRESULT Library_SecretLabs_NETMF_Diagnostics_SecretLabs_NETMF_Diagnostics_AllocationProfiler::Start___STATIC__VOID__U4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER(); hr = S_OK;
+    {
+        UINT32 param0;
+        TINYCLR_CHECK_HRESULT( Interop_Marshal_UINT32( stack, 0, param0 ) );
+
+        AllocationProfiler::Start( param0, hr );
+        TINYCLR_CHECK_HRESULT( hr );
+    }
+    TINYCLR_NOCLEANUP();
+}
+
+HRESULT Library_SecretLabs_NETMF_Diagnostics_SecretLabs_NETMF_Diagnostics_AllocationProfiler::Stop___STATIC__VOID( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER(); hr = S_OK;
+    {
+        AllocationProfiler::Stop( hr );
+        TINYCLR_CHECK_HRESULT( hr );
+    }
+    TINYCLR_NOCLEANUP();
+}
+
+HRESULT Library_SecretLabs_NETMF_Diagnostics_SecretLabs_NETMF_Diagnostics_AllocationProfiler::Dump___STATIC__VOID( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER(); hr = S_OK;
+    {
+        AllocationProfiler::Dump( hr );
+        TINYCLR_CHECK_HRESULT( hr );
+    }
+    TINYCLR_NOCLEANUP();
+}
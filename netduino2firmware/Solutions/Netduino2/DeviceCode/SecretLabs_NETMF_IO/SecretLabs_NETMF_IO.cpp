@@ -18,6 +18,9 @@ static const CLR_RT_MethodHandler method_lookup[] =
     Library_SecretLabs_NETMF_IO_SecretLabs_NETMF_IO_StorageDevice::SDSPI_Mount___STATIC__VOID__STRING__U4__U4__U4,
     Library_SecretLabs_NETMF_IO_SecretLabs_NETMF_IO_StorageDevice::SDSPI_Unmount___STATIC__VOID,
     NULL,
+    Library_SecretLabs_NETMF_IO_SecretLabs_NETMF_IO_StorageDevice::SDSPI_Flush___STATIC__VOID,
+    Library_SecretLabs_NETMF_IO_SecretLabs_NETMF_IO_StorageDevice::SDSPI_GetCacheHits___STATIC__U4,
+    Library_SecretLabs_NETMF_IO_SecretLabs_NETMF_IO_StorageDevice::SDSPI_GetCacheMisses___STATIC__U4,
 };
 
 const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_SecretLabs_NETMF_IO =
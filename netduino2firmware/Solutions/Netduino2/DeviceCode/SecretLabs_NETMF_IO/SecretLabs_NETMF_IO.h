@@ -17,6 +17,9 @@ struct Library_SecretLabs_NETMF_IO_SecretLabs_NETMF_IO_StorageDevice
 
     TINYCLR_NATIVE_DECLARE(SDSPI_Mount___STATIC__VOID__STRING__U4__U4__U4);
     TINYCLR_NATIVE_DECLARE(SDSPI_Unmount___STATIC__VOID);
+    TINYCLR_NATIVE_DECLARE(SDSPI_Flush___STATIC__VOID);
+    TINYCLR_NATIVE_DECLARE(SDSPI_GetCacheHits___STATIC__U4);
+    TINYCLR_NATIVE_DECLARE(SDSPI_GetCacheMisses___STATIC__U4);
 
     //--//
 
@@ -23,6 +23,9 @@ extern SD_BL_CONFIGURATION        g_SD_BL_Config;
 
 
 void SD_InsertEjectIsr( GPIO_PIN Pin, BOOL PinState, void* Param );
+BOOL SD_BS_Cache_Flush();
+UINT32 SD_BS_Cache_Invalidate();
+void SD_BS_Cache_GetCounters( UINT32* pHits, UINT32* pMisses );
 
 void StorageDevice::SDSPI_Mount( LPCSTR param0, UINT32 param1, UINT32 param2, UINT32 param3, HRESULT &hr )
 {
@@ -59,11 +62,46 @@ void StorageDevice::SDSPI_Mount( LPCSTR param0, UINT32 param1, UINT32 param2, UI
 void StorageDevice::SDSPI_Unmount( HRESULT &hr )
 {
     FS_UnmountVolume( &g_SD_BS );
+
+    // write back whatever the unmount left in the sector cache
+    SD_BS_Cache_Flush();
+    SD_BS_Cache_Invalidate();
+
     BlockStorageList::RemoveDevice( &g_SD_BS, TRUE );
 }
 
-void SD_InsertEjectIsr( GPIO_PIN Pin, BOOL PinState, void* Param )
+void StorageDevice::SDSPI_Flush( HRESULT &hr )
+{
+    if (!SD_BS_Cache_Flush())
+    {
+        hr = CLR_E_FILE_IO;
+    }
+}
+
+UINT32 StorageDevice::SDSPI_GetCacheHits( HRESULT &hr )
+{
+    UINT32 hits, misses;
+
+    SD_BS_Cache_GetCounters( &hits, &misses );
+
+    return hits;
+}
+
+UINT32 StorageDevice::SDSPI_GetCacheMisses( HRESULT &hr )
+{
+    UINT32 hits, misses;
+
+    SD_BS_Cache_GetCounters( &hits, &misses );
+
+    return misses;
+}
+
+static HAL_CONTINUATION s_SD_InsertEjectContinuation;
+
+static void SD_InsertEject( void* Param )
 {
+    BOOL PinState = CPU_GPIO_GetPinState( (GPIO_PIN)(size_t)Param );
+
     // if the SD card was inserted, try to mount it; if it was ejected, try to unmount it.
     if ( !PinState ) 
     {
@@ -75,8 +113,25 @@ void SD_InsertEjectIsr( GPIO_PIN Pin, BOOL PinState, void* Param )
     }
     else
     {
-        // card was ejected
+        // card was ejected; it may already be off the bus, so drop the cache instead of flushing
+        UINT32 lost = SD_BS_Cache_Invalidate();
+
+        if (lost != 0)
+        {
+            debug_printf( "SD: card removed, %d cached sectors not written\r\n", lost );
+        }
+
         FS_UnmountVolume( &g_SD_BS );
         BlockStorageList::RemoveDevice( &g_SD_BS, TRUE );
     }
 }
+
+void SD_InsertEjectIsr( GPIO_PIN Pin, BOOL PinState, void* Param )
+{
+    // the SD driver may be in the middle of a transfer; mount and unmount from thread context
+    if ( !s_SD_InsertEjectContinuation.IsLinked() )
+    {
+        s_SD_InsertEjectContinuation.InitializeCallback( SD_InsertEject, (void*)(size_t)Pin );
+        s_SD_InsertEjectContinuation.Enqueue();
+    }
+}
@@ -26,6 +26,9 @@ namespace SecretLabs
                 // Declaration of stubs. These functions are implemented by Interop code developers
                 static void SDSPI_Mount( LPCSTR param0, UINT32 param1, UINT32 param2, UINT32 param3, HRESULT &hr );
                 static void SDSPI_Unmount( HRESULT &hr );
+                static void SDSPI_Flush( HRESULT &hr );
+                static UINT32 SDSPI_GetCacheHits( HRESULT &hr );
+                static UINT32 SDSPI_GetCacheMisses( HRESULT &hr );
             };
         }
     }
@@ -44,3 +44,37 @@ HRESULT Library_SecretLabs_NETMF_IO_SecretLabs_NETMF_IO_StorageDevice::SDSPI_Unm
     }
     TINYCLR_NOCLEANUP();
 }
+
+HRESULT Library_SecretLabs_NETMF_IO_SecretLabs_NETMF_IO_StorageDevice::SDSPI_Flush___STATIC__VOID( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER(); hr = S_OK;
+    {
+        StorageDevice::SDSPI_Flush( hr );
+        TINYCLR_CHECK_HRESULT( hr );
+    }
+    TINYCLR_NOCLEANUP();
+}
+
+HRESULT Library_SecretLabs_NETMF_IO_SecretLabs_NETMF_IO_StorageDevice::SDSPI_GetCacheHits___STATIC__U4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER(); hr = S_OK;
+    {
+        UINT32 retVal = StorageDevice::SDSPI_GetCacheHits( hr );
+        TINYCLR_CHECK_HRESULT( hr );
+        SetResult_UINT32( stack, retVal );
+
+    }
+    TINYCLR_NOCLEANUP();
+}
+
+HRESULT Library_SecretLabs_NETMF_IO_SecretLabs_NETMF_IO_StorageDevice::SDSPI_GetCacheMisses___STATIC__U4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER(); hr = S_OK;
+    {
+        UINT32 retVal = StorageDevice::SDSPI_GetCacheMisses( hr );
+        TINYCLR_CHECK_HRESULT( hr );
+        SetResult_UINT32( stack, retVal );
+
+    }
+    TINYCLR_NOCLEANUP();
+}
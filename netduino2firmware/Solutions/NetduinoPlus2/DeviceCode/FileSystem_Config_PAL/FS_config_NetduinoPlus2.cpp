@@ -16,6 +16,8 @@ extern struct IBlockStorageDevice g_SD_BS_DeviceTable;
 extern struct BLOCK_CONFIG        g_SD_BS_Config;
 
 void SD_InsertEjectIsr( GPIO_PIN Pin, BOOL PinState, void* Param );
+BOOL SD_BS_Cache_Flush();
+UINT32 SD_BS_Cache_Invalidate();
 
 void FS_AddVolumes()
 {
@@ -43,8 +45,12 @@ FILESYSTEM_INTERFACES g_AvailableFSInterfaces[] =
     { &g_FAT32_FILE_SYSTEM_DriverInterface, &g_FAT32_STREAM_DriverInterface },
 };
 
-void SD_InsertEjectIsr( GPIO_PIN Pin, BOOL PinState, void* Param )
+static HAL_CONTINUATION s_SD_InsertEjectContinuation;
+
+static void SD_InsertEject( void* Param )
 {
+    BOOL PinState = CPU_GPIO_GetPinState( (GPIO_PIN)(size_t)Param );
+
     // if the SD card was inserted, try to mount it; if it was ejected, try to unmount it.
     if ( !PinState ) 
     {
@@ -56,12 +62,29 @@ void SD_InsertEjectIsr( GPIO_PIN Pin, BOOL PinState, void* Param )
     }
     else
     {
-        // card was ejected
+        // card was ejected; it may already be off the bus, so drop the cache instead of flushing
+        UINT32 lost = SD_BS_Cache_Invalidate();
+
+        if (lost != 0)
+        {
+            debug_printf( "SD: card removed, %d cached sectors not written\r\n", lost );
+        }
+
         FS_UnmountVolume( &g_SD_BS );
         BlockStorageList::RemoveDevice( &g_SD_BS, TRUE );
     }
 }
 
+void SD_InsertEjectIsr( GPIO_PIN Pin, BOOL PinState, void* Param )
+{
+    // the SD driver may be in the middle of a transfer; mount and unmount from thread context
+    if ( !s_SD_InsertEjectContinuation.IsLinked() )
+    {
+        s_SD_InsertEjectContinuation.InitializeCallback( SD_InsertEject, (void*)(size_t)Pin );
+        s_SD_InsertEjectContinuation.Enqueue();
+    }
+}
+
 const size_t g_InstalledFSCount = 1;
 
 #if defined(ADS_LINKER_BUG__NOT_ALL_UNUSED_VARIABLES_ARE_REMOVED)
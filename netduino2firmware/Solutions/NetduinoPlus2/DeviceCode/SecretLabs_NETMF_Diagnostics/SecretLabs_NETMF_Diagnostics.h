@@ -20,6 +20,16 @@ struct Library_SecretLabs_NETMF_Diagnostics_SecretLabs_NETMF_Diagnostics_Transpo
 
 };
 
+struct Library_SecretLabs_NETMF_Diagnostics_SecretLabs_NETMF_Diagnostics_AllocationProfiler
+{
+    TINYCLR_NATIVE_DECLARE(Start___STATIC__VOID__U4);
+    TINYCLR_NATIVE_DECLARE(Stop___STATIC__VOID);
+    TINYCLR_NATIVE_DECLARE(Dump___STATIC__VOID);
+
+    //--//
+
+};
+
 
 
 extern const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_SecretLabs_NETMF_Diagnostics;
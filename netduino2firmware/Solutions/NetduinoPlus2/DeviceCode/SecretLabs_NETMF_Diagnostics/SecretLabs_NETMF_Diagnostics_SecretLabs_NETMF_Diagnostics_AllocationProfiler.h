@@ -0,0 +1,34 @@
+//-----------------------------------------------------------------------------
+//
+//                   ** WARNING! ** 
+//    This file was generated automatically by a tool.
+//    Re-running the tool will overwrite this file.
+//    You should copy this file to a custom location
+//    before adding any customization in the copy to
+//    prevent loss of your changes when the tool is
+//    re-run.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef _SECRETLABS_NETMF_DIAGNOSTICS_SECRETLABS_NETMF_DIAGNOSTICS_ALLOCATIONPROFILER_H_
+#define _SECRETLABS_NETMF_DIAGNOSTICS_SECRETLABS_NETMF_DIAGNOSTICS_ALLOCATIONPROFILER_H_
+
+namespace SecretLabs
+{
+    namespace NETMF
+    {
+        namespace Diagnostics
+        {
+            struct AllocationProfiler
+            {
+                // Helper Functions to access fields of managed object
+                // Declaration of stubs. These functions are implemented by Interop code developers
+                static void Start( UINT32 param0, HRESULT &hr );
+                static void Stop( HRESULT &hr );
+                static void Dump( HRESULT &hr );
+            };
+        }
+    }
+}
+#endif  //_SECRETLABS_NETMF_DIAGNOSTICS_SECRETLABS_NETMF_DIAGNOSTICS_ALLOCATIONPROFILER_H_
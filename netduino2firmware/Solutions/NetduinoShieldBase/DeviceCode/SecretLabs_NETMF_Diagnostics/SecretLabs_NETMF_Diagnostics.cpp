@@ -16,6 +16,9 @@ static const CLR_RT_MethodHandler method_lookup[] =
     NULL,
     Library_SecretLabs_NETMF_Diagnostics_SecretLabs_NETMF_Diagnostics_Transport::TransportInterface_Set___STATIC__VOID__U1,
     Library_SecretLabs_NETMF_Diagnostics_SecretLabs_NETMF_Diagnostics_Transport::TransportInterface_Get___STATIC__U1,
+    Library_SecretLabs_NETMF_Diagnostics_SecretLabs_NETMF_Diagnostics_AllocationProfiler::Start___STATIC__VOID__U4,
+    Library_SecretLabs_NETMF_Diagnostics_SecretLabs_NETMF_Diagnostics_AllocationProfiler::Stop___STATIC__VOID,
+    Library_SecretLabs_NETMF_Diagnostics_SecretLabs_NETMF_Diagnostics_AllocationProfiler::Dump___STATIC__VOID,
 };
 
 const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_SecretLabs_NETMF_Diagnostics =
@@ -0,0 +1,34 @@
+//-----------------------------------------------------------------------------
+//
+//                   ** WARNING! ** 
+//    This file was generated automatically by a tool.
+//    Re-running the tool will overwrite this file.
+//    You should copy this file to a custom location
+//    before adding any customization in the copy to
+//    prevent loss of your changes when the tool is
+//    re-run.
+//
+//-----------------------------------------------------------------------------
+
+
+#include "SecretLabs_NETMF_Diagnostics.h"
+#include "SecretLabs_NETMF_Diagnostics_SecretLabs_NETMF_Diagnostics_AllocationProfiler.h"
+
+using namespace SecretLabs::NETMF::Diagnostics;
+
+// sampleInterval: record the calling method of every Nth allocation, 0 for counters only
+void AllocationProfiler::Start( UINT32 param0, HRESULT &hr )
+{
+    g_CLR_RT_ExecutionEngine.AllocationProfile_Start( param0 );
+}
+
+void AllocationProfiler::Stop( HRESULT &hr )
+{
+    g_CLR_RT_ExecutionEngine.AllocationProfile_Stop();
+}
+
+// prints the counters and samples on the debug channel
+void AllocationProfiler::Dump( HRESULT &hr )
+{
+    g_CLR_RT_ExecutionEngine.AllocationProfile_Dump();
+}